@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <numeric>
 #include <ext/type_traits.hpp>
+#include <viewed/forward_types.hpp>
 
 #include <varalgo/std_variant_traits.hpp>
 
@@ -24,6 +25,57 @@ namespace viewed
 		return varalgo::variant_traits<std::decay_t<Pred>>::visit(vis, std::forward<Pred>(pred));
 	}
 
+	namespace detail
+	{
+		template <class Pred> static auto fields_visitor(const Pred & pred, int) -> decltype(field_mask_type(pred.fields())) { return pred.fields(); }
+		template <class Pred> static field_mask_type fields_visitor(const Pred & pred, long) { return all_fields; }
+	}
+
+	/// record fields predicate depends on: pred.fields() if provided, all_fields otherwise.
+	/// used to decide if update of some fields can affect sorting/filtering
+	template <class Pred> static field_mask_type predicate_fields(Pred && pred)
+	{
+		auto vis = [](const auto & pred) { return detail::fields_visitor(pred, 0); };
+		return varalgo::variant_traits<std::decay_t<Pred>>::visit(vis, std::forward<Pred>(pred));
+	}
+
+	namespace detail
+	{
+		template <class Pred> static auto equal_visitor(const Pred & p1, const Pred & p2, int) -> decltype(static_cast<bool>(p1 == p2)) { return p1 == p2; }
+		template <class Pred> static bool equal_visitor(const Pred & p1, const Pred & p2, long) { return false; }
+	}
+
+	/// true if predicates are equal via operator ==, always false for predicates without it.
+	/// used to recognize same filter state, like sfview_qtbase filter history
+	template <class Pred> static bool predicates_equal(const Pred & p1, const Pred & p2)
+	{
+		return detail::equal_visitor(p1, p2, 0);
+	}
+
+	namespace detail
+	{
+		template <class Pred, class Range> static auto invalidate_visitor(const Pred & pred, const Range & erased, const Range & updated, int) -> decltype(pred.invalidate(erased, updated), void()) { pred.invalidate(erased, updated); }
+		template <class Pred, class Range> static void invalidate_visitor(const Pred & pred, const Range & erased, const Range & updated, long) {}
+
+		template <class Pred> static auto invalidate_all_visitor(const Pred & pred, int) -> decltype(pred.invalidate(), void()) { pred.invalidate(); }
+		template <class Pred> static void invalidate_all_visitor(const Pred & pred, long) {}
+	}
+
+	/// notifies predicate caching per record data(like collation_less), that records were erased/updated:
+	/// calls pred.invalidate(erased, updated) if provided
+	template <class Pred, class Range> static void invalidate_predicate(const Pred & pred, const Range & erased, const Range & updated)
+	{
+		auto vis = [&erased, &updated](const auto & pred) { detail::invalidate_visitor(pred, erased, updated, 0); };
+		varalgo::variant_traits<Pred>::visit(vis, pred);
+	}
+
+	/// notifies predicate caching per record data, that all records were erased: calls pred.invalidate() if provided
+	template <class Pred> static void invalidate_predicate(const Pred & pred)
+	{
+		auto vis = [](const auto & pred) { detail::invalidate_all_visitor(pred, 0); };
+		varalgo::variant_traits<Pred>::visit(vis, pred);
+	}
+
 	namespace detail
 	{
 		constexpr int INDEX_MARK_MASK = 1 << (sizeof(int) * CHAR_BIT - 1);
@@ -178,6 +230,33 @@ namespace viewed
 		return index_array;
 	}
 
+	/// marks elements of longest strictly increasing subsequence of [first, last):
+	/// out[i] is set to true if i-th element belongs to it, other out elements are not touched.
+	/// returns length of subsequence, complexity O(N log N)
+	template <class RandomAccessIterator, class OutRandomAccessIterator>
+	std::size_t mark_longest_increasing(RandomAccessIterator first, RandomAccessIterator last, OutRandomAccessIterator out)
+	{
+		auto size = last - first;
+		std::vector<std::ptrdiff_t> tails, prev(size, -1); // tails[k] - index of smallest tail of increasing subsequence of length k + 1
+		auto less = [first](std::ptrdiff_t idx, const auto & val) { return first[idx] < val; };
+
+		for (std::ptrdiff_t idx = 0; idx < size; ++idx)
+		{
+			auto pos = std::lower_bound(tails.begin(), tails.end(), first[idx], less);
+			if (pos != tails.begin()) prev[idx] = pos[-1];
+
+			if (pos == tails.end()) tails.push_back(idx);
+			else                    *pos = idx;
+		}
+
+		if (tails.empty()) return 0;
+
+		for (auto idx = tails.back(); idx >= 0; idx = prev[idx])
+			out[idx] = true;
+
+		return tails.size();
+	}
+
 	/// removes elements from [first, last) by indexes given in [ifirst, ilast)
 	template <class RandomAccessIterator, class Iterator>
 	RandomAccessIterator remove_indexes(RandomAccessIterator first, RandomAccessIterator last,
@@ -1,9 +1,17 @@
 ﻿#pragma once
+#include <cassert>
+#include <memory>
+#include <cstddef>
+#include <utility>  // for exchange
+#include <type_traits>
+#include <vector>
 #include <algorithm>
 #include <iterator> // for back_inserter
 #include <viewed/signal_traits.hpp>
 #include <viewed/algorithm.hpp>
+#include <viewed/container_snapshot.hpp>
 #include <ext/try_reserve.hpp>
+#include <boost/mpl/size.hpp>
 
 namespace viewed
 {
@@ -40,12 +48,84 @@ namespace viewed
 
 		/// update takes current internal_value_type rvalue as first argument and some generic type as second.
 		/// It updates current value with new data
-		/// usually second type is some reference of value_type
+		/// usually second type is some reference of value_type.
+		/// update can return bool: false means record was not changed and it will not be reported to views as updated,
+		/// void result means record is always changed. see also change_suppressing_traits.
+		/// update can also return field_mask_type: mask of changed record fields, 0 - record was not changed.
+		/// Those masks are provided to views via updated_fields, so they can emit more precise qt signals
 		struct update_type;
 		static const update_type                  update;
+
+		/// optional: generation stamp stored in record, if provided - assign finds erased records in linear time,
+		/// without sorting pointers to all current records. see also stamped_container_traits
+		static unsigned get_generation(const internal_value_type & val);
+		static void     set_generation(const internal_value_type & val, unsigned generation);
 	};
 	*/
 
+	/// traits adapter, adds generation stamp support to BaseTraits(see container_traits description above).
+	/// Stamp is stored in record data member pointed by Member, it's type should be unsigned,
+	/// member is written via const_cast, so it's better to declare it as mutable.
+	/// example: stamped_container_traits<hash_container_traits<record, record_hash, record_equal>, &record::generation>
+	template <class BaseTraits, auto Member>
+	struct stamped_container_traits : BaseTraits
+	{
+		template <class Value>
+		static unsigned get_generation(const Value & val) noexcept { return val.*Member; }
+
+		template <class Value>
+		static void set_generation(const Value & val, unsigned generation) noexcept { const_cast<Value &>(val).*Member = generation; }
+	};
+
+	/// traits adapter, replaces BaseTraits update with one that assigns new value only if it differs from current one.
+	/// Unchanged records are not reported to views as updated.
+	/// Type must provide operator == comparing whole record, not only key part
+	template <class BaseTraits>
+	struct change_suppressing_traits : BaseTraits
+	{
+		struct update_type
+		{
+			typedef bool result_type;
+
+			template <class Value, class NewValue>
+			result_type operator()(Value & val, NewValue && newval) const
+			{
+				if (val == newval) return false;
+
+				val = std::forward<NewValue>(newval);
+				return true;
+			}
+		};
+
+		static constexpr update_type update {};
+	};
+
+	namespace detail
+	{
+		template <class Traits, class Value>
+		using update_result_t = decltype(Traits::update(std::declval<Value &>(), std::declval<const Value &>()));
+
+		/// traits update reports changed fields masks, not just void/bool
+		template <class Traits, class Value>
+		constexpr bool reports_field_masks_v =
+			std::is_integral_v<update_result_t<Traits, Value>> and not std::is_same_v<update_result_t<Traits, Value>, bool>;
+
+		/// store is multi_index_container with more than one index, see indexed_container_traits
+		template <class Store, class = void>
+		struct has_secondary_indexes : std::false_type {};
+
+		template <class Store>
+		struct has_secondary_indexes<Store, std::void_t<typename Store::index_type_list>>
+			: std::bool_constant<(boost::mpl::size<typename Store::index_type_list>::value > 1)> {};
+
+		template <class Traits, class Value, class = void>
+		struct has_generation_stamp : std::false_type {};
+
+		template <class Traits, class Value>
+		struct has_generation_stamp<Traits, Value, std::void_t<decltype(Traits::get_generation(std::declval<const Value &>()))>>
+			: std::true_type {};
+	}
+
 	/*
 	/// signal_traits describes types used for communication between stores and views
 	struct signal_traits
@@ -56,6 +136,10 @@ namespace viewed
 		/// static functor/method for creating signal_range_type from some signal_store_type
 		static signal_range_type make_range(const Type ** first, const Type ** last);
 
+		/// random access range of field_mask_type, and functor/method creating it
+		typedef implementation-defined field_mask_range_type;
+		static field_mask_range_type make_mask_range(const field_mask_type * first, const field_mask_type * last);
+
 		/// signals should be boost::signals or compatible:
 		/// * connect call, connection, scoped_connection
 		/// * emission via call like: signal(args...)
@@ -152,12 +236,33 @@ namespace viewed
 		typedef typename signal_traits::erase_signal_type   erase_signal_type;
 		typedef typename signal_traits::clear_signal_type   clear_signal_type;
 
+		typedef typename signal_traits::field_mask_range_type field_mask_range_type;
+
+	protected:
+		typedef std::vector<field_mask_type> field_mask_store_type;
+		static constexpr bool reports_fields = detail::reports_field_masks_v<traits_type, value_type>;
+		static constexpr bool stamped = detail::has_generation_stamp<traits_type, typename main_store_type::value_type>::value;
+
 	public:
 		// view related pointer helpers
 		using view_pointer_type = const_pointer;
 		static view_pointer_type get_view_pointer(const_reference ref)     noexcept { return &ref; }
 		static const_reference   get_view_reference(view_pointer_type ptr) noexcept { return *ptr; }
 
+	public:
+		class batch_scope;
+
+		/// immutable copy of container records, see snapshot
+		typedef container_snapshot<value_type>           snapshot_type;
+		typedef std::shared_ptr<const snapshot_type>     snapshot_pointer;
+
+		/// update statistics, see get_update_counters
+		struct update_counters
+		{
+			std::size_t updated    = 0; // records changed by upsert/assign
+			std::size_t suppressed = 0; // updates reported by traits update as no change
+		};
+
 	protected:
 		main_store_type m_store;
 
@@ -165,6 +270,22 @@ namespace viewed
 		erase_signal_type  m_erase_signal;
 		clear_signal_type  m_clear_signal;
 
+		/// current generation stamp, used only if traits support it
+		unsigned m_generation = 0;
+		update_counters m_update_counters;
+		/// changed fields masks of currently emitted update signal, see updated_fields
+		field_mask_range_type m_updated_fields;
+
+		/// batch state, see begin_batch.
+		/// pending erased records are sorted by pointer value and unique,
+		/// pending fields masks are parallel to pending updated records(if traits report them)
+		unsigned m_batch_depth = 0;
+		signal_store_type m_batch_erased, m_batch_updated, m_batch_inserted;
+		field_mask_store_type m_batch_updated_fields;
+
+		/// tracks changes for snapshot, created on first snapshot call
+		std::unique_ptr<snapshot_tracker<value_type>> m_snapshot_tracker;
+
 	public:
 		const_iterator begin()  const noexcept { return m_store.cbegin(); }
 		const_iterator end()    const noexcept { return m_store.cend(); }
@@ -176,6 +297,16 @@ namespace viewed
 		template <class CompatibleKey>
 		const_iterator count(const CompatibleKey & key) const { return m_store.count(key); }
 
+		/// lookups by secondary index tagged with Tag, see indexed_container_traits.
+		/// find_by returns iterator of container, equal_range_by - pair of Tag index iterators
+		template <class Tag, class CompatibleKey>
+		const_iterator find_by(const CompatibleKey & key) const
+		{ return m_store.template project<0>(m_store.template get<Tag>().find(key)); }
+
+		template <class Tag, class CompatibleKey>
+		auto equal_range_by(const CompatibleKey & key) const
+		{ return m_store.template get<Tag>().equal_range(key); }
+
 		size_type size() const noexcept { return m_store.size(); }
 		bool empty()     const noexcept { return m_store.empty(); }
 
@@ -184,7 +315,29 @@ namespace viewed
 		template <class... Args> connection on_update(Args && ... args) { return m_update_signal.connect(std::forward<Args>(args)...); }
 		template <class... Args> connection on_clear(Args && ... args)  { return m_clear_signal.connect(std::forward<Args>(args)...); }
 
+		/// counters of real and suppressed(unchanged) updates of existing records
+		const update_counters & get_update_counters() const noexcept { return m_update_counters; }
+		void reset_update_counters() noexcept { m_update_counters = {}; }
+
+		/// changed fields masks, parallel to sorted_updated range, valid only while update signal is emitted.
+		/// Empty if traits update does not report them - all fields should be considered changed
+		field_mask_range_type updated_fields() const noexcept { return m_updated_fields; }
+
 	protected:
+		/// updates existing record rec with newval via traits_type::update and counts it.
+		/// returns mask of changed fields, 0 if update reported record as unchanged.
+		/// If store has secondary indexes - update is done via modify, so they stay consistent
+		template <class Arg>
+		field_mask_type update_record(const value_type & rec, Arg && newval);
+		template <class Arg>
+		field_mask_type apply_update(value_type & val, Arg && newval);
+
+		/// removes records satisfying pred from updated, and corresponding masks from parallel updated_fields(if not empty)
+		template <class Pred>
+		static void remove_updated_if(signal_store_type & updated, field_mask_store_type & updated_fields, Pred pred);
+		/// sorts updated by pointer value together with parallel updated_fields, masks of duplicate records are merged
+		static void sort_updated_fields(signal_store_type & updated, field_mask_store_type & updated_fields);
+
 		/// finds and updates or appends elements from [first; last) into internal store m_store
 		/// those elements also placed into upserted_recs for further notifications of views
 		template <class SinglePassIterator>
@@ -193,14 +346,47 @@ namespace viewed
 		template <class SinglePassIterator>
 		void assign_newrecs(SinglePassIterator first, SinglePassIterator last);
 
+		/// assign_newrecs implementation for traits with generation stamps:
+		/// all new records are stamped with new generation, records with older stamps are erased. complexity is linear
+		template <class SinglePassIterator>
+		void stamped_assign_newrecs(SinglePassIterator first, SinglePassIterator last);
+		/// advances m_generation, handles wrap around
+		unsigned next_generation();
+
 		/// erases elements [first, last) from attached views
 		void erase_from_views(const_iterator first, const_iterator last);
 
-		/// notifies views about update
-		void notify_views(signal_store_type & erased, signal_store_type & updated, signal_store_type & inserted);
+		/// notifies views about update, updated_fields is either empty or parallel to updated
+		void notify_views(signal_store_type & erased, signal_store_type & updated, signal_store_type & inserted,
+		                  field_mask_store_type & updated_fields);
+
+		/// appends records into pending batch stores, views are notified about them in end_batch
+		void gather_batch(signal_store_type & erased, signal_store_type & updated, signal_store_type & inserted,
+		                  field_mask_store_type & updated_fields);
+		/// record was erased and upserted again in same batch - it's not erased anymore
+		void revive_batch_erased(const_pointer ptr);
+		/// ends batch started by begin_batch, if it's outermost one - notifies views with merged ranges
+		/// and removes erased records from internal store
+		void end_batch();
+
+	public:
+		/// starts batch update, which lasts while returned scope object is alive.
+		/// While batch is active upsert/assign/erase do not emit signals, instead erased/updated/inserted records are gathered
+		/// and views are notified once, with merged ranges, when outermost batch ends.
+		/// Erased records are kept in container until batch ends. Batches can be nested.
+		batch_scope begin_batch() { ++m_batch_depth; return batch_scope(this); }
+		/// returns true if there is an active batch
+		bool in_batch() const noexcept { return m_batch_depth != 0; }
+
+		/// returns immutable reference counted copy of current records, which can be iterated from any thread.
+		/// First call starts tracking container changes, following calls copy only changed parts of previous snapshot.
+		/// Inside active batch last snapshot is returned, changes are seen after batch ends.
+		/// Only if snapshot must be rebuilt(first call, after clear or mass erase) it is built from current records: without records inserted by batch,
+		/// with records erased by it, but with in place updates done by batch - old values are not kept.
+		snapshot_pointer snapshot();
 
 	public:
-		/// erases all elements
+		/// erases all elements, pending batch records are discarded
 		void clear();
 		/// erases elements [first, last) from internal store and views
 		/// [first, last) must be a valid range
@@ -240,12 +426,136 @@ namespace viewed
 		associative_conatiner_base & operator =(associative_conatiner_base && op) = default;
 	};
 
+	/// RAII batch scope, see associative_conatiner_base::begin_batch.
+	/// Ends batch on destruction or on explicit commit call
+	template <class Type, class Traits, class SignalTraits>
+	class associative_conatiner_base<Type, Traits, SignalTraits>::batch_scope
+	{
+		associative_conatiner_base * m_owner = nullptr;
+
+	public:
+		/// ends batch before scope object is destroyed
+		void commit() { if (m_owner) std::exchange(m_owner, nullptr)->end_batch(); }
+
+	public:
+		batch_scope() = default;
+		explicit batch_scope(associative_conatiner_base * owner) noexcept : m_owner(owner) {}
+		~batch_scope() { commit(); }
+
+		batch_scope(batch_scope && op) noexcept : m_owner(std::exchange(op.m_owner, nullptr)) {}
+		batch_scope & operator =(batch_scope && op) { if (this != &op) { commit(); m_owner = std::exchange(op.m_owner, nullptr); } return *this; }
+
+		batch_scope(const batch_scope &) = delete;
+		batch_scope & operator =(const batch_scope &) = delete;
+	};
+
+	template <class Type, class Traits, class SignalTraits>
+	template <class Arg>
+	auto associative_conatiner_base<Type, Traits, SignalTraits>::update_record(const value_type & rec, Arg && newval) -> field_mask_type
+	{
+		if constexpr (not detail::has_secondary_indexes<main_store_type>::value)
+			return apply_update(const_cast<value_type &>(rec), std::forward<Arg>(newval));
+		else
+		{
+			field_mask_type changed = 0;
+			auto modifier = [this, &changed, &newval](value_type & val) { changed = apply_update(val, std::forward<Arg>(newval)); };
+
+			// secondary indexes are non unique(see indexed_container_traits), primary key is not changed - modify can't fail
+			bool modified = m_store.modify(m_store.iterator_to(rec), modifier);
+			assert(modified); (void)modified;
+			return changed;
+		}
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	template <class Arg>
+	auto associative_conatiner_base<Type, Traits, SignalTraits>::apply_update(value_type & val, Arg && newval) -> field_mask_type
+	{
+		using result_type = decltype(traits_type::update(val, std::forward<Arg>(newval)));
+
+		if constexpr (std::is_void_v<result_type>)
+		{
+			traits_type::update(val, std::forward<Arg>(newval));
+			++m_update_counters.updated;
+			return all_fields;
+		}
+		else if constexpr (std::is_same_v<result_type, bool>)
+		{
+			bool changed = traits_type::update(val, std::forward<Arg>(newval));
+			++(changed ? m_update_counters.updated : m_update_counters.suppressed);
+			return changed ? all_fields : 0;
+		}
+		else
+		{
+			field_mask_type changed = traits_type::update(val, std::forward<Arg>(newval));
+			++(changed ? m_update_counters.updated : m_update_counters.suppressed);
+			return changed;
+		}
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	template <class Pred>
+	void associative_conatiner_base<Type, Traits, SignalTraits>::remove_updated_if
+		(signal_store_type & updated, field_mask_store_type & updated_fields, Pred pred)
+	{
+		if (updated_fields.empty())
+		{
+			updated.erase(std::remove_if(updated.begin(), updated.end(), pred), updated.end());
+			return;
+		}
+
+		assert(updated.size() == updated_fields.size());
+		std::size_t count = updated.size(), out = 0;
+		for (std::size_t idx = 0; idx < count; ++idx)
+		{
+			if (pred(updated[idx])) continue;
+
+			updated[out] = updated[idx];
+			updated_fields[out] = updated_fields[idx];
+			++out;
+		}
+
+		updated.resize(out);
+		updated_fields.resize(out);
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	void associative_conatiner_base<Type, Traits, SignalTraits>::sort_updated_fields
+		(signal_store_type & updated, field_mask_store_type & updated_fields)
+	{
+		assert(updated.size() == updated_fields.size());
+
+		std::vector<std::pair<const_pointer, field_mask_type>> records(updated.size());
+		for (std::size_t idx = 0; idx < records.size(); ++idx)
+			records[idx] = {updated[idx], updated_fields[idx]};
+
+		auto less = [](const auto & r1, const auto & r2) { return r1.first < r2.first; };
+		std::sort(records.begin(), records.end(), less);
+
+		std::size_t out = 0;
+		for (auto & rec : records)
+		{
+			if (out != 0 and updated[out - 1] == rec.first)
+				updated_fields[out - 1] |= rec.second;
+			else
+			{
+				updated[out] = rec.first;
+				updated_fields[out] = rec.second;
+				++out;
+			}
+		}
+
+		updated.resize(out);
+		updated_fields.resize(out);
+	}
+
 	template <class Type, class Traits, class SignalTraits>
 	template <class SinglePassIterator>
 	void associative_conatiner_base<Type, Traits, SignalTraits>::upsert_newrecs
 		(SinglePassIterator first, SinglePassIterator last)
 	{
 		signal_store_type erased, updated, inserted;
+		field_mask_store_type updated_fields;
 		ext::try_reserve(updated, first, last);
 		ext::try_reserve(inserted, first, last);
 
@@ -260,16 +570,29 @@ namespace viewed
 			auto * ptr = get_pointer(*where);
 			if (inserted_into_store)
 			{
+				// incoming stamp is arbitrary, it could collide with next assign generation
+				if constexpr (stamped) traits_type::set_generation(*where, 0);
 				inserted.push_back(ptr);
 			}
 			else
 			{
-				traits_type::update(const_cast<value_type &>(*where), std::forward<decltype(val)>(val));
-				updated.push_back(ptr);
+				unsigned generation = 0;
+				if constexpr (stamped) generation = traits_type::get_generation(*where);
+
+				if (auto mask = update_record(*where, std::forward<decltype(val)>(val)))
+				{
+					updated.push_back(ptr);
+					if constexpr (reports_fields) updated_fields.push_back(mask);
+				}
+
+				// update can overwrite stamp, keep current one
+				if constexpr (stamped) traits_type::set_generation(*where, generation);
+				if (m_batch_depth) revive_batch_erased(ptr);
 			}
 		}
 
-		notify_views(erased, updated, inserted);
+		if (m_batch_depth) return gather_batch(erased, updated, inserted, updated_fields);
+		notify_views(erased, updated, inserted, updated_fields);
 	}
 
 	template <class Type, class Traits, class SignalTraits>
@@ -277,7 +600,11 @@ namespace viewed
 	void associative_conatiner_base<Type, Traits, SignalTraits>::assign_newrecs
 		(SinglePassIterator first, SinglePassIterator last)
 	{
+		if constexpr (stamped)
+			return stamped_assign_newrecs(first, last);
+
 		signal_store_type erased, updated, inserted;
+		field_mask_store_type updated_fields;
 		ext::try_reserve(updated, first, last);
 		ext::try_reserve(inserted, first, last);
 
@@ -303,8 +630,12 @@ namespace viewed
 			}
 			else
 			{
-				traits_type::update(const_cast<value_type &>(*where), std::forward<decltype(val)>(val));
-				updated.push_back(ptr);
+				if (auto mask = update_record(*where, std::forward<decltype(val)>(val)))
+				{
+					updated.push_back(ptr);
+					if constexpr (reports_fields) updated_fields.push_back(mask);
+				}
+				if (m_batch_depth) revive_batch_erased(ptr);
 
 				// mark found item in erase list
 				auto it = std::lower_bound(erased_first, erased_last, ptr);
@@ -314,11 +645,78 @@ namespace viewed
 
 		erased_last = std::remove_if(erased_first, erased_last, viewed::marked_pointer);
 		erased.erase(erased_last, erased.end());
-		notify_views(erased, updated, inserted);
+		if (m_batch_depth) return gather_batch(erased, updated, inserted, updated_fields);
 
+		notify_views(erased, updated, inserted, updated_fields);
 		for (auto * ptr : erased) m_store.erase(*ptr);
 	}
 
+	template <class Type, class Traits, class SignalTraits>
+	template <class SinglePassIterator>
+	void associative_conatiner_base<Type, Traits, SignalTraits>::stamped_assign_newrecs
+		(SinglePassIterator first, SinglePassIterator last)
+	{
+		signal_store_type erased, updated, inserted;
+		field_mask_store_type updated_fields;
+		ext::try_reserve(updated, first, last);
+		ext::try_reserve(inserted, first, last);
+
+		auto generation = next_generation();
+
+		for (; first != last; ++first)
+		{
+			auto && val = *first;
+
+			typename main_store_type::const_iterator where;
+			bool inserted_into_store;
+			std::tie(where, inserted_into_store) = m_store.insert(std::forward<decltype(val)>(val));
+
+			auto * ptr = get_pointer(*where);
+			if (inserted_into_store)
+			{
+				inserted.push_back(ptr);
+			}
+			else
+			{
+				if (auto mask = update_record(*where, std::forward<decltype(val)>(val)))
+				{
+					updated.push_back(ptr);
+					if constexpr (reports_fields) updated_fields.push_back(mask);
+				}
+				if (m_batch_depth) revive_batch_erased(ptr);
+			}
+
+			// stamp after update, update can overwrite it
+			traits_type::set_generation(*where, generation);
+		}
+
+		// records not stamped with current generation were not assigned - they are erased
+		for (auto & val : m_store)
+		{
+			if (traits_type::get_generation(val) != generation)
+				erased.push_back(get_pointer(val));
+		}
+
+		std::sort(erased.begin(), erased.end());
+		if (m_batch_depth) return gather_batch(erased, updated, inserted, updated_fields);
+
+		notify_views(erased, updated, inserted, updated_fields);
+		for (auto * ptr : erased) m_store.erase(*ptr);
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	unsigned associative_conatiner_base<Type, Traits, SignalTraits>::next_generation()
+	{
+		if (++m_generation == 0)
+		{
+			// wrap around: old stamps can collide with new generations - reset them all
+			for (auto & val : m_store) traits_type::set_generation(val, 0);
+			m_generation = 1;
+		}
+
+		return m_generation;
+	}
+
 	template <class Type, class Traits, class SignalTraits>
 	void associative_conatiner_base<Type, Traits, SignalTraits>::erase_from_views(const_iterator first, const_iterator last)
 	{
@@ -327,24 +725,27 @@ namespace viewed
 
 		auto rawRange = signal_traits::make_range(todel.data(), todel.data() + todel.size());
 		m_erase_signal(rawRange);
+		if (m_snapshot_tracker) m_snapshot_tracker->on_erase(rawRange);
 	}
 
 	template <class Type, class Traits, class SignalTraits>
 	void associative_conatiner_base<Type, Traits, SignalTraits>::clear()
 	{
 		m_clear_signal();
+		if (m_snapshot_tracker) m_snapshot_tracker->on_clear();
+
+		m_batch_erased.clear();
+		m_batch_updated.clear();
+		m_batch_inserted.clear();
+		m_batch_updated_fields.clear();
 		m_store.clear();
 	}
 
 	template <class Type, class Traits, class SignalTraits>
 	void associative_conatiner_base<Type, Traits, SignalTraits>::notify_views
-		(signal_store_type & erased, signal_store_type & updated, signal_store_type & inserted)
+		(signal_store_type & erased, signal_store_type & updated, signal_store_type & inserted,
+		 field_mask_store_type & updated_fields)
 	{
-		auto inserted_first = inserted.data();
-		auto inserted_last  = inserted_first + inserted.size();
-		auto updated_first  = updated.data();
-		auto updated_last   = updated_first + updated.size();
-
 		// both assign_newrecs and upsert_newrecs can produce duplicates:
 		// * several updates
 		// * insert + update
@@ -353,28 +754,128 @@ namespace viewed
 		// update + followed update(s) -> update
 		// there are will no erased duplicates
 
-		std::sort(updated_first, updated_last);
-		updated_last = std::unique(updated_first, updated_last);
+		if (updated_fields.empty())
+		{
+			std::sort(updated.begin(), updated.end());
+			updated.erase(std::unique(updated.begin(), updated.end()), updated.end());
+		}
+		else
+			sort_updated_fields(updated, updated_fields);
+
+		auto updated_first = updated.begin();
+		auto updated_last  = updated.end();
 
-		for (auto it = inserted_first; it != inserted_last; ++it)
+		// marking keeps updated sorted - pointers are at least 2 byte aligned
+		for (auto * ptr : inserted)
 		{
-			auto ptr = *it;
 			auto found_it = std::lower_bound(updated_first, updated_last, ptr);
-			if (found_it != updated_last and ptr == *found_it) *it = viewed::mark_pointer(ptr);
+			if (found_it != updated_last and ptr == *found_it) *found_it = viewed::mark_pointer(ptr);
 		}
 
-		updated_last = std::remove_if(updated_first, updated_last, viewed::marked_pointer);
+		remove_updated_if(updated, updated_fields, viewed::marked_pointer);
 
-		auto urr = signal_traits::make_range(updated_first, updated_last);
-		auto irr = signal_traits::make_range(inserted_first, inserted_last);
+		auto urr = signal_traits::make_range(updated.data(), updated.data() + updated.size());
+		auto irr = signal_traits::make_range(inserted.data(), inserted.data() + inserted.size());
 		auto err = signal_traits::make_range(erased.data(), erased.data() + erased.size());
+
+		m_updated_fields = signal_traits::make_mask_range(updated_fields.data(), updated_fields.data() + updated_fields.size());
 		m_update_signal(err, urr, irr);
+		m_updated_fields = {};
+
+		if (m_snapshot_tracker) m_snapshot_tracker->on_update(err, urr, irr);
 	}
 
+	template <class Type, class Traits, class SignalTraits>
+	void associative_conatiner_base<Type, Traits, SignalTraits>::gather_batch
+		(signal_store_type & erased, signal_store_type & updated, signal_store_type & inserted,
+		 field_mask_store_type & updated_fields)
+	{
+		m_batch_updated.insert(m_batch_updated.end(), updated.begin(), updated.end());
+		m_batch_updated_fields.insert(m_batch_updated_fields.end(), updated_fields.begin(), updated_fields.end());
+		m_batch_inserted.insert(m_batch_inserted.end(), inserted.begin(), inserted.end());
+		if (erased.empty()) return;
+
+		// keep pending erased sorted and unique, revive_batch_erased and end_batch use binary search on them
+		auto middle = m_batch_erased.insert(m_batch_erased.end(), erased.begin(), erased.end());
+		std::sort(middle, m_batch_erased.end());
+		std::inplace_merge(m_batch_erased.begin(), middle, m_batch_erased.end());
+		m_batch_erased.erase(std::unique(m_batch_erased.begin(), m_batch_erased.end()), m_batch_erased.end());
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	void associative_conatiner_base<Type, Traits, SignalTraits>::revive_batch_erased(const_pointer ptr)
+	{
+		auto first = m_batch_erased.begin();
+		auto last  = m_batch_erased.end();
+
+		auto it = std::lower_bound(first, last, ptr);
+		if (it != last and *it == ptr) m_batch_erased.erase(it);
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	void associative_conatiner_base<Type, Traits, SignalTraits>::end_batch()
+	{
+		assert(m_batch_depth);
+		if (--m_batch_depth) return;
+
+		signal_store_type erased, updated, inserted, signal_erased;
+		field_mask_store_type updated_fields;
+		erased.swap(m_batch_erased);
+		updated.swap(m_batch_updated);
+		inserted.swap(m_batch_inserted);
+		updated_fields.swap(m_batch_updated_fields);
+
+		if (erased.empty() and updated.empty() and inserted.empty())
+			return;
+
+		auto erased_first = erased.begin();
+		auto erased_last  = erased.end();
+
+		// update followed by erase -> just erase
+		auto is_erased = [erased_first, erased_last](auto * ptr) { return std::binary_search(erased_first, erased_last, ptr); };
+		remove_updated_if(updated, updated_fields, is_erased);
+
+		// insert followed by erase -> views never saw those records, they are only removed from the store.
+		// Mark them in both lists, marking keeps erased sorted - pointers are at least 2 byte aligned
+		for (auto & ptr : inserted)
+		{
+			auto it = std::lower_bound(erased_first, erased_last, ptr);
+			if (it != erased_last and *it == ptr) *it = ptr = viewed::mark_pointer(ptr);
+		}
+
+		inserted.erase(std::remove_if(inserted.begin(), inserted.end(), viewed::marked_pointer), inserted.end());
+		std::remove_copy_if(erased_first, erased_last, std::back_inserter(signal_erased), viewed::marked_pointer);
+
+		notify_views(signal_erased, updated, inserted, updated_fields);
+		for (auto * ptr : erased) m_store.erase(*viewed::unmark_pointer(ptr));
+	}
+
+
+	template <class Type, class Traits, class SignalTraits>
+	auto associative_conatiner_base<Type, Traits, SignalTraits>::snapshot() -> snapshot_pointer
+	{
+		if (not m_snapshot_tracker)
+			m_snapshot_tracker = std::make_unique<snapshot_tracker<value_type>>();
+
+		if (m_batch_depth)
+			return m_snapshot_tracker->batch_snapshot(begin(), end(), m_batch_inserted);
+
+		return m_snapshot_tracker->snapshot(begin(), end());
+	}
 
 	template <class Type, class Traits, class SignalTraits>
 	auto associative_conatiner_base<Type, Traits, SignalTraits>::erase(const_iterator first, const_iterator last) -> const_iterator
 	{
+		if (m_batch_depth)
+		{
+			// records are erased from store when batch ends
+			signal_store_type erased, none;
+			field_mask_store_type no_fields;
+			std::transform(first, last, std::back_inserter(erased), get_pointer);
+			gather_batch(erased, none, none, no_fields);
+			return last;
+		}
+
 		erase_from_views(first, last);
 		return m_store.erase(first, last);
 	}
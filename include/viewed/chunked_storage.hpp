@@ -0,0 +1,159 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <utility>
+#include <type_traits>
+
+namespace viewed
+{
+	/// Stable address storage: elements are constructed densely in fixed size chunks,
+	/// one allocation per ChunkSize elements, instead of one allocation per element.
+	///
+	/// make constructs element in next free slot of current chunk and returns owning handle.
+	/// Handle destroys element on destruction/reset, chunk is freed when all it's elements are destroyed.
+	/// Slots of destroyed elements are not reused - chunk is freed as a whole,
+	/// this suits sequence_container well: elements are appended at back and erased mostly from front or all at once.
+	///
+	/// Handles can outlive storage object itself. Not thread safe.
+	template <class Type, std::size_t ChunkSize = 256>
+	class chunked_storage
+	{
+		static_assert(ChunkSize > 0);
+
+	public:
+		class handle;
+
+	protected:
+		struct chunk
+		{
+			std::size_t live = 0;  // number of constructed, not yet destroyed elements
+			bool sealed = false;   // no more elements will be constructed in this chunk
+			std::aligned_storage_t<sizeof(Type), alignof(Type)> slots[ChunkSize];
+		};
+
+		static void release(chunk * ch) noexcept;
+
+	protected:
+		chunk * m_current = nullptr;
+		std::size_t m_used = 0;
+
+	protected:
+		/// seals current chunk and frees it if it's already empty
+		void seal_current() noexcept;
+
+	public:
+		/// constructs element from args in next free slot, allocates new chunk if current is full
+		template <class... Args>
+		handle make(Args && ... args);
+
+	public:
+		chunked_storage() = default;
+		~chunked_storage() { seal_current(); }
+
+		chunked_storage(chunked_storage && op) noexcept
+			: m_current(std::exchange(op.m_current, nullptr)), m_used(std::exchange(op.m_used, 0)) {}
+
+		chunked_storage & operator =(chunked_storage && op) noexcept
+		{
+			if (this != &op)
+			{
+				seal_current();
+				m_current = std::exchange(op.m_current, nullptr);
+				m_used = std::exchange(op.m_used, 0);
+			}
+
+			return *this;
+		}
+
+		chunked_storage(const chunked_storage &) = delete;
+		chunked_storage & operator =(const chunked_storage &) = delete;
+	};
+
+	/// owning handle to element of chunked_storage, move only, similar to std::unique_ptr
+	template <class Type, std::size_t ChunkSize>
+	class chunked_storage<Type, ChunkSize>::handle
+	{
+		friend chunked_storage;
+
+		Type * m_ptr = nullptr;
+		chunk * m_chunk = nullptr;
+
+	protected:
+		handle(Type * ptr, chunk * ch) noexcept : m_ptr(ptr), m_chunk(ch) {}
+
+	public:
+		Type * get() const noexcept { return m_ptr; }
+		Type & operator *() const noexcept { return *m_ptr; }
+		Type * operator ->() const noexcept { return m_ptr; }
+		explicit operator bool() const noexcept { return m_ptr != nullptr; }
+
+		/// destroys owned element
+		void reset() noexcept;
+
+	public:
+		handle() = default;
+		~handle() { reset(); }
+
+		handle(handle && op) noexcept : m_ptr(std::exchange(op.m_ptr, nullptr)), m_chunk(std::exchange(op.m_chunk, nullptr)) {}
+		handle & operator =(handle && op) noexcept
+		{
+			if (this != &op)
+			{
+				reset();
+				m_ptr = std::exchange(op.m_ptr, nullptr);
+				m_chunk = std::exchange(op.m_chunk, nullptr);
+			}
+
+			return *this;
+		}
+
+		handle(const handle &) = delete;
+		handle & operator =(const handle &) = delete;
+	};
+
+	template <class Type, std::size_t ChunkSize>
+	void chunked_storage<Type, ChunkSize>::release(chunk * ch) noexcept
+	{
+		assert(ch->live);
+		if (--ch->live == 0 and ch->sealed)
+			delete ch;
+	}
+
+	template <class Type, std::size_t ChunkSize>
+	void chunked_storage<Type, ChunkSize>::seal_current() noexcept
+	{
+		if (not m_current) return;
+
+		auto * ch = std::exchange(m_current, nullptr);
+		m_used = 0;
+
+		ch->sealed = true;
+		if (ch->live == 0) delete ch;
+	}
+
+	template <class Type, std::size_t ChunkSize>
+	template <class... Args>
+	auto chunked_storage<Type, ChunkSize>::make(Args && ... args) -> handle
+	{
+		if (m_used == ChunkSize) seal_current();
+		if (not m_current) m_current = new chunk;
+
+		void * slot = &m_current->slots[m_used];
+		auto * ptr = ::new (slot) Type(std::forward<Args>(args)...);
+
+		++m_used;
+		++m_current->live;
+		return handle(ptr, m_current);
+	}
+
+	template <class Type, std::size_t ChunkSize>
+	void chunked_storage<Type, ChunkSize>::handle::reset() noexcept
+	{
+		if (not m_ptr) return;
+
+		std::destroy_at(std::exchange(m_ptr, nullptr));
+		release(std::exchange(m_chunk, nullptr));
+	}
+}
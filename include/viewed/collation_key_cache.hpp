@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <unordered_map>
+
+#include <QtCore/QString>
+#include <QtCore/QCollator>
+
+namespace viewed
+{
+	/// Cache of locale-aware collation sort keys(QCollatorSortKey) of records, keyed by record pointer.
+	/// QCollator::compare is expensive and called O(N log N) times while sorting,
+	/// with cache QCollator::sortKey is called once per record, and sort keys comparison is plain binary comparison.
+	///
+	/// Entries must be invalidated when records are updated or erased(pointers can be reused by new records),
+	/// collation_less does it via invalidate hooks called by sfview_qtbase, see viewed::invalidate_predicate.
+	/// Not thread safe: keys are computed lazily on first access.
+	///
+	/// @Param Type - record type
+	/// @Param Projection - functor returning string to collate: QString(const Type &)
+	template <class Type, class Projection>
+	class collation_key_cache
+	{
+	public:
+		typedef Type value_type;
+		typedef Projection projection_type;
+
+	protected:
+		QCollator m_collator;
+		projection_type m_projection;
+		mutable std::unordered_map<const value_type *, QCollatorSortKey> m_keys;
+
+	public:
+		const QCollator & collator() const noexcept { return m_collator; }
+		/// number of cached keys
+		std::size_t size() const noexcept { return m_keys.size(); }
+
+		/// sort key of record, computed on first access
+		const QCollatorSortKey & key(const value_type & rec) const;
+		/// compares records via cached sort keys, same result as QCollator::compare
+		int compare(const value_type & r1, const value_type & r2) const { return key(r1).compare(key(r2)); }
+
+		/// drops cached key of record
+		void invalidate(const value_type * ptr) { m_keys.erase(ptr); }
+		/// drops cached keys of records pointed by [first, last)
+		template <class Iterator>
+		void invalidate(Iterator first, Iterator last);
+		/// drops all cached keys
+		void clear() noexcept { m_keys.clear(); }
+
+	public:
+		explicit collation_key_cache(QCollator collator = {}, projection_type projection = {})
+			: m_collator(std::move(collator)), m_projection(std::move(projection)) {}
+	};
+
+	template <class Type, class Projection>
+	const QCollatorSortKey & collation_key_cache<Type, Projection>::key(const value_type & rec) const
+	{
+		auto it = m_keys.find(&rec);
+		if (it == m_keys.end())
+			it = m_keys.emplace(&rec, m_collator.sortKey(m_projection(rec))).first;
+
+		return it->second;
+	}
+
+	template <class Type, class Projection>
+	template <class Iterator>
+	void collation_key_cache<Type, Projection>::invalidate(Iterator first, Iterator last)
+	{
+		if (m_keys.empty()) return;
+
+		for (; first != last; ++first)
+			m_keys.erase(*first);
+	}
+
+	/// Sort predicate ordering records by collation sort keys, see collation_key_cache.
+	/// Provides key projection(see sort_key_projection.hpp), so sfview_qtbase projects keys once per sort,
+	/// and invalidate hooks(see invalidate_predicate), so keys of updated/erased records are dropped by view.
+	/// Copies share same cache, it's valid for records of one container only.
+	///
+	///   auto by_name = [](const record & rec) { return rec.name; };
+	///   QCollator collator;
+	///   collator.setCaseSensitivity(Qt::CaseInsensitive);
+	///   view.sort_by(viewed::collation_less<record, decltype(by_name)>(collator, by_name));
+	template <class Type, class Projection>
+	class collation_less
+	{
+	public:
+		typedef collation_key_cache<Type, Projection> cache_type;
+
+	protected:
+		std::shared_ptr<cache_type> m_cache;
+
+	public:
+		cache_type & cache() const noexcept { return *m_cache; }
+
+		QCollatorSortKey key(const Type & rec) const { return m_cache->key(rec); }
+		bool operator()(const Type & r1, const Type & r2) const { return m_cache->compare(r1, r2) < 0; }
+
+		template <class Range>
+		void invalidate(const Range & erased, const Range & updated) const
+		{
+			m_cache->invalidate(erased.begin(), erased.end());
+			m_cache->invalidate(updated.begin(), updated.end());
+		}
+
+		void invalidate() const { m_cache->clear(); }
+
+	public:
+		explicit collation_less(QCollator collator = {}, Projection projection = {})
+			: m_cache(std::make_shared<cache_type>(std::move(collator), std::move(projection))) {}
+	};
+}
@@ -0,0 +1,187 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <filesystem>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace viewed
+{
+	/// Binary serializer of container records, used by save_container/load_container.
+	/// Specialize it for your record type(or pass your own serializer type to those functions), interface:
+	///  * version - record format version, stored in file header, files with different version are not loaded
+	///  * size(rec) - number of bytes needed for serialized record
+	///  * write(rec, buffer) - writes record into buffer of size(rec) bytes
+	///  * read(first, last) - reads record from [first, last), advances first, throws std::runtime_error if data is malformed
+	///
+	/// default implementation supports trivially copyable types, record bytes are stored as is.
+	template <class Type>
+	struct record_serializer
+	{
+		static_assert(std::is_trivially_copyable_v<Type>, "record_serializer should be specialized for not trivially copyable types");
+
+		static constexpr std::uint32_t version = 1;
+
+		static std::size_t size(const Type & rec) noexcept { return sizeof(Type); }
+		static void write(const Type & rec, char * buffer) noexcept { std::memcpy(buffer, &rec, sizeof(Type)); }
+
+		static Type read(const char * & first, const char * last)
+		{
+			if (static_cast<std::size_t>(last - first) < sizeof(Type))
+				throw std::runtime_error("viewed::record_serializer: truncated record");
+
+			Type rec;
+			std::memcpy(&rec, first, sizeof(Type));
+			first += sizeof(Type);
+			return rec;
+		}
+	};
+
+	/// file format: persistence_header followed by data_size bytes of serialized records.
+	/// Data is stored in native byte order, files written on different byte order machine are rejected
+	struct persistence_header
+	{
+		static constexpr char signature[8] = {'V', 'I', 'E', 'W', 'E', 'D', 'C', '\0'};
+		static constexpr std::uint32_t current_format_version = 1;
+		static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+		char magic[8];
+		std::uint32_t byte_order;
+		std::uint32_t format_version;
+		std::uint32_t record_version;
+		std::uint32_t record_size_hint; // sizeof(record) on writing side, helps to detect incompatible builds
+		std::uint64_t record_count;
+		std::uint64_t data_size;
+		char reserved[24];
+	};
+
+	static_assert(sizeof(persistence_header) == 64);
+
+	/// writes records of cont into file path, file is written under temporary name and then renamed.
+	/// throws std::ios_base::failure/std::filesystem::filesystem_error on io errors
+	template <class Container, class Serializer = record_serializer<typename Container::value_type>>
+	void save_container(const Container & cont, const std::string & path);
+
+	/// loads records from file path, previously written by save_container, and assigns them into cont.
+	/// file is memory mapped and bulk loaded, container store is reserved if container supports it.
+	/// returns false if file does not exist or it's header is incompatible(different format/record version, etc) -
+	/// container is not changed in this case. Throws std::runtime_error if file is corrupted
+	template <class Container, class Serializer = record_serializer<typename Container::value_type>>
+	bool load_container(Container & cont, const std::string & path);
+
+	namespace detail
+	{
+		template <class Container, class = void>
+		struct has_reserve : std::false_type {};
+
+		template <class Container>
+		struct has_reserve<Container, std::void_t<decltype(std::declval<Container &>().reserve(std::size_t()))>> : std::true_type {};
+	}
+
+	template <class Container, class Serializer>
+	void save_container(const Container & cont, const std::string & path)
+	{
+		typedef typename Container::value_type value_type;
+
+		persistence_header header = {};
+		std::memcpy(header.magic, persistence_header::signature, sizeof(header.magic));
+		header.byte_order = persistence_header::byte_order_mark;
+		header.format_version = persistence_header::current_format_version;
+		header.record_version = Serializer::version;
+		header.record_size_hint = sizeof(value_type);
+
+		auto tmp_path = path + ".tmp";
+		std::ofstream file;
+		file.exceptions(std::ios::failbit | std::ios::badbit);
+		file.open(tmp_path, std::ios::binary | std::ios::trunc);
+
+		// header is rewritten with counts at the end
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+		constexpr std::size_t flush_size = 1024 * 1024;
+		std::vector<char> buffer;
+		buffer.reserve(flush_size);
+
+		for (const value_type & rec : cont)
+		{
+			auto sz = Serializer::size(rec);
+			auto pos = buffer.size();
+			buffer.resize(pos + sz);
+			Serializer::write(rec, buffer.data() + pos);
+
+			++header.record_count;
+			header.data_size += sz;
+
+			if (buffer.size() >= flush_size)
+			{
+				file.write(buffer.data(), buffer.size());
+				buffer.clear();
+			}
+		}
+
+		file.write(buffer.data(), buffer.size());
+		file.seekp(0);
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		file.close();
+
+		std::filesystem::rename(tmp_path, path);
+	}
+
+	template <class Container, class Serializer>
+	bool load_container(Container & cont, const std::string & path)
+	{
+		namespace bip = boost::interprocess;
+		typedef typename Container::value_type value_type;
+
+		std::error_code ec;
+		if (not std::filesystem::is_regular_file(path, ec) or std::filesystem::file_size(path, ec) < sizeof(persistence_header))
+			return false;
+
+		bip::file_mapping mapping(path.c_str(), bip::read_only);
+		bip::mapped_region region(mapping, bip::read_only);
+
+		auto * first = static_cast<const char *>(region.get_address());
+		auto * last  = first + region.get_size();
+
+		persistence_header header;
+		std::memcpy(&header, first, sizeof(header));
+		first += sizeof(header);
+
+		bool compatible =
+			    std::memcmp(header.magic, persistence_header::signature, sizeof(header.magic)) == 0
+			and header.byte_order == persistence_header::byte_order_mark
+			and header.format_version == persistence_header::current_format_version
+			and header.record_version == Serializer::version
+			and header.record_size_hint == sizeof(value_type);
+
+		if (not compatible) return false;
+
+		if (header.data_size != static_cast<std::uint64_t>(last - first))
+			throw std::runtime_error("viewed::load_container: data size mismatch, file is truncated or corrupted");
+
+		// records are deserialized first, so container is not touched if data is corrupted
+		std::vector<value_type> records;
+		records.reserve(static_cast<std::size_t>(std::min(header.record_count, header.data_size)));
+
+		for (std::uint64_t idx = 0; idx < header.record_count; ++idx)
+			records.push_back(Serializer::read(first, last));
+
+		if (first != last)
+			throw std::runtime_error("viewed::load_container: trailing data, file is corrupted");
+
+		if constexpr (detail::has_reserve<Container>::value)
+			cont.reserve(records.size());
+
+		cont.assign(std::make_move_iterator(records.begin()), std::make_move_iterator(records.end()));
+		return true;
+	}
+}
@@ -0,0 +1,294 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/iterator/filter_iterator.hpp>
+
+namespace viewed
+{
+	/// Immutable, reference counted copy of viewed container records, see associative_conatiner_base::snapshot.
+	/// Can be freely passed to and iterated from other threads, while container itself continues to change.
+	///
+	/// Records are stored in fixed size chunks shared between consecutive snapshots:
+	/// new snapshot copies only chunks with changed records(copy on write), other chunks are shared via shared_ptr.
+	/// Chunks can have holes from erased records, iterators skip them.
+	template <class Type, std::size_t ChunkSize = 64>
+	class container_snapshot
+	{
+		typedef container_snapshot self_type;
+
+	public:
+		typedef Type                value_type;
+		typedef const Type &        const_reference;
+		typedef const Type *        const_pointer;
+		typedef const_reference     reference;
+		typedef const_pointer       pointer;
+		typedef std::size_t         size_type;
+		typedef std::ptrdiff_t      difference_type;
+
+		typedef std::array<std::optional<Type>, ChunkSize> chunk_type;
+		typedef std::shared_ptr<const chunk_type>          chunk_pointer;
+		typedef std::vector<chunk_pointer>                 chunk_vector;
+
+		static constexpr std::size_t chunk_size = ChunkSize;
+
+	public:
+		class const_iterator : public boost::iterator_facade<const_iterator, const value_type, boost::forward_traversal_tag>
+		{
+			friend boost::iterator_core_access;
+			friend container_snapshot;
+
+			const chunk_vector * m_chunks = nullptr;
+			std::size_t m_pos = 0; // chunk index * ChunkSize + slot index
+
+		private:
+			const value_type & dereference() const noexcept { return *(*(*m_chunks)[m_pos / ChunkSize])[m_pos % ChunkSize]; }
+			bool equal(const const_iterator & other) const noexcept { return m_pos == other.m_pos; }
+			void increment() noexcept { ++m_pos; skip_empty(); }
+
+			void skip_empty() noexcept
+			{
+				std::size_t last = m_chunks->size() * ChunkSize;
+				for (; m_pos < last; ++m_pos)
+				{
+					const auto & chunk = (*m_chunks)[m_pos / ChunkSize];
+					if (not chunk) { m_pos += ChunkSize - m_pos % ChunkSize - 1; continue; }
+					if ((*chunk)[m_pos % ChunkSize]) break;
+				}
+			}
+
+			const_iterator(const chunk_vector * chunks, std::size_t pos) noexcept
+				: m_chunks(chunks), m_pos(pos) { skip_empty(); }
+
+		public:
+			const_iterator() = default;
+		};
+
+		using iterator = const_iterator;
+
+	protected:
+		chunk_vector m_chunks;
+		size_type m_size = 0;
+
+	public:
+		const_iterator begin()  const noexcept { return const_iterator(&m_chunks, 0); }
+		const_iterator end()    const noexcept { return const_iterator(&m_chunks, m_chunks.size() * ChunkSize); }
+		const_iterator cbegin() const noexcept { return begin(); }
+		const_iterator cend()   const noexcept { return end(); }
+
+		size_type size() const noexcept { return m_size; }
+		bool empty()     const noexcept { return m_size == 0; }
+
+		/// chunks of this snapshot, null chunk is same as chunk without records
+		const chunk_vector & chunks() const noexcept { return m_chunks; }
+
+	public:
+		container_snapshot() = default;
+		container_snapshot(chunk_vector chunks, size_type size)
+			: m_chunks(std::move(chunks)), m_size(size) {}
+	};
+
+	/// Tracks changes of viewed container and builds container_snapshot's from them.
+	/// Used by containers: they call on_update/on_erase/on_clear when they notify their views.
+	///
+	/// Each record is assigned a slot in snapshot chunks, slots are never reused - this preserves container order for sequence containers.
+	/// When erased slots become more than live ones - snapshot is rebuilt from scratch on next request(amortized O(1) per record).
+	/// Otherwise snapshot costs O(chunks count) for copying chunk pointers plus O(ChunkSize) for each changed chunk.
+	template <class Type, std::size_t ChunkSize = 64>
+	class snapshot_tracker
+	{
+	public:
+		typedef container_snapshot<Type, ChunkSize>     snapshot_type;
+		typedef std::shared_ptr<const snapshot_type>    snapshot_pointer;
+
+	protected:
+		typedef typename snapshot_type::chunk_type    chunk_type;
+		typedef typename snapshot_type::chunk_vector  chunk_vector;
+
+	protected:
+		std::unordered_map<const Type *, std::size_t> m_slots; // record -> slot
+		std::vector<const Type *> m_records;                    // slot -> record, nullptr for erased
+		std::vector<std::size_t> m_dirty;                       // slots changed since last snapshot, can have duplicates
+		std::size_t m_live = 0;
+		bool m_rebuild = true;
+
+		snapshot_pointer m_last;
+
+	protected:
+		/// forgets everything, snapshot will be rebuilt from container on next request
+		void reset() noexcept;
+
+		template <class Iterator>
+		snapshot_pointer rebuild(Iterator first, Iterator last);
+		snapshot_pointer apply_dirty();
+
+	public:
+		/// container notifications, ranges of pointers to records
+		template <class Range>
+		void on_update(const Range & erased, const Range & updated, const Range & inserted);
+		template <class Range>
+		void on_erase(const Range & erased);
+		void on_clear() noexcept { reset(); }
+
+		/// returns snapshot of container records [first; last), range is only used when snapshot should be rebuilt
+		template <class Iterator>
+		snapshot_pointer snapshot(Iterator first, Iterator last);
+		/// snapshot requested inside container batch: last snapshot is returned as is, changes are applied after batch ends.
+		/// If there is no snapshot to return(first call or tracker was reset) - it's rebuilt from [first; last)
+		/// without pending records - inserted by batch, those are announced via on_update when batch ends.
+		/// Such snapshot sees in place updates done by batch, container can't provide old values
+		template <class Iterator, class Range>
+		snapshot_pointer batch_snapshot(Iterator first, Iterator last, const Range & pending);
+	};
+
+	template <class Type, std::size_t ChunkSize>
+	void snapshot_tracker<Type, ChunkSize>::reset() noexcept
+	{
+		m_rebuild = true;
+		m_slots.clear();
+		m_records.clear();
+		m_dirty.clear();
+		m_live = 0;
+	}
+
+	template <class Type, std::size_t ChunkSize>
+	template <class Range>
+	void snapshot_tracker<Type, ChunkSize>::on_erase(const Range & erased)
+	{
+		if (m_rebuild) return;
+
+		for (const Type * ptr : erased)
+		{
+			auto it = m_slots.find(ptr);
+			assert(it != m_slots.end());
+			if (it == m_slots.end()) continue;
+
+			m_records[it->second] = nullptr;
+			m_dirty.push_back(it->second);
+			m_slots.erase(it);
+			--m_live;
+		}
+
+		if (m_records.size() - m_live > std::max(m_live, ChunkSize))
+			reset();
+	}
+
+	template <class Type, std::size_t ChunkSize>
+	template <class Range>
+	void snapshot_tracker<Type, ChunkSize>::on_update(const Range & erased, const Range & updated, const Range & inserted)
+	{
+		on_erase(erased);
+		if (m_rebuild) return;
+
+		for (const Type * ptr : updated)
+		{
+			auto it = m_slots.find(ptr);
+			assert(it != m_slots.end());
+			if (it != m_slots.end()) m_dirty.push_back(it->second);
+		}
+
+		for (const Type * ptr : inserted)
+		{
+			std::size_t slot = m_records.size();
+			m_records.push_back(ptr);
+			m_slots.emplace(ptr, slot);
+			m_dirty.push_back(slot);
+			++m_live;
+		}
+	}
+
+	template <class Type, std::size_t ChunkSize>
+	template <class Iterator>
+	auto snapshot_tracker<Type, ChunkSize>::snapshot(Iterator first, Iterator last) -> snapshot_pointer
+	{
+		if (m_rebuild)
+			return m_last = rebuild(first, last);
+
+		if (not m_dirty.empty() or not m_last)
+			m_last = apply_dirty();
+
+		return m_last;
+	}
+
+	template <class Type, std::size_t ChunkSize>
+	template <class Iterator, class Range>
+	auto snapshot_tracker<Type, ChunkSize>::batch_snapshot(Iterator first, Iterator last, const Range & pending) -> snapshot_pointer
+	{
+		// dirty chunks would be copied from live records, mixing batch changes into snapshot
+		if (not m_rebuild)
+			return m_last;
+
+		// pending records are skipped, otherwise on_update would give them second slot
+		std::vector<const Type *> sorted_pending(pending.begin(), pending.end());
+		std::sort(sorted_pending.begin(), sorted_pending.end());
+
+		auto announced = [&sorted_pending](const Type & rec) { return not std::binary_search(sorted_pending.begin(), sorted_pending.end(), &rec); };
+		return m_last = rebuild(boost::make_filter_iterator(announced, first, last), boost::make_filter_iterator(announced, last, last));
+	}
+
+	template <class Type, std::size_t ChunkSize>
+	template <class Iterator>
+	auto snapshot_tracker<Type, ChunkSize>::rebuild(Iterator first, Iterator last) -> snapshot_pointer
+	{
+		reset();
+		m_rebuild = false;
+
+		chunk_vector chunks;
+		std::shared_ptr<chunk_type> chunk;
+
+		for (; first != last; ++first)
+		{
+			const Type & rec = *first;
+			std::size_t slot = m_records.size();
+			if (slot % ChunkSize == 0)
+				chunks.push_back(chunk = std::make_shared<chunk_type>());
+
+			(*chunk)[slot % ChunkSize].emplace(rec);
+			m_records.push_back(&rec);
+			m_slots.emplace(&rec, slot);
+		}
+
+		m_live = m_records.size();
+		return std::make_shared<snapshot_type>(std::move(chunks), m_live);
+	}
+
+	template <class Type, std::size_t ChunkSize>
+	auto snapshot_tracker<Type, ChunkSize>::apply_dirty() -> snapshot_pointer
+	{
+		chunk_vector chunks;
+		if (m_last) chunks = m_last->chunks();
+		chunks.resize((m_records.size() + ChunkSize - 1) / ChunkSize);
+
+		std::sort(m_dirty.begin(), m_dirty.end());
+		m_dirty.erase(std::unique(m_dirty.begin(), m_dirty.end()), m_dirty.end());
+
+		auto first = m_dirty.begin();
+		auto last  = m_dirty.end();
+		while (first != last)
+		{
+			// copy chunk once for all it's changed slots
+			std::size_t chunk_idx = *first / ChunkSize;
+			auto & chunk_ptr = chunks[chunk_idx];
+			auto chunk = chunk_ptr ? std::make_shared<chunk_type>(*chunk_ptr) : std::make_shared<chunk_type>();
+
+			for (; first != last and *first / ChunkSize == chunk_idx; ++first)
+			{
+				auto & slot = (*chunk)[*first % ChunkSize];
+				if (const Type * rec = m_records[*first]) slot.emplace(*rec);
+				else                                      slot.reset();
+			}
+
+			chunk_ptr = std::move(chunk);
+		}
+
+		m_dirty.clear();
+		return std::make_shared<snapshot_type>(std::move(chunks), m_live);
+	}
+}
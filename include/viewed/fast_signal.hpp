@@ -0,0 +1,340 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include <viewed/signal_traits.hpp>
+
+namespace viewed
+{
+	/// Lightweight single threaded signal/slot implementation, used by fast_signal_traits.
+	/// Provides subset of boost::signals2 interface used by viewed containers and views:
+	///  signal: connect(functor) -> connection, operator()(args...), num_slots, disconnect_all_slots
+	///  connection: connected, disconnect
+	///  scoped_connection: move only owning connection, disconnects in destructor
+	///
+	/// Slots are stored in a plain vector: small trivially copyable functors(function pointers, lambdas capturing this)
+	/// are stored in place, others are heap allocated. Emission does not touch any reference counters or mutexes,
+	/// there are no combiners, slot groups or tracking. Slots can connect/disconnect while signal is emitted,
+	/// new slots will be called starting from next emission.
+	/// Connection can outlive signal, it does nothing in this case.
+
+	class fast_connection;
+	class fast_scoped_connection;
+
+	template <class Signature>
+	class fast_signal;
+
+	namespace detail
+	{
+		/// connection bookkeeping part of fast_signal, referenced by connections via weak_ptr
+		class fast_slot_list_base
+		{
+		protected:
+			std::vector<std::uint64_t> m_ids; // slot ids, parallel to slots, 0 - disconnected slot
+			std::uint64_t m_next_id = 1;
+			unsigned m_emitting = 0;
+			bool m_dirty = false;
+
+		protected:
+			auto find_slot(std::uint64_t id) const noexcept { return std::find(m_ids.begin(), m_ids.end(), id); }
+
+		public:
+			virtual bool connected(std::uint64_t id) const noexcept = 0;
+			virtual void disconnect(std::uint64_t id) noexcept = 0;
+
+		protected:
+			fast_slot_list_base() = default;
+			~fast_slot_list_base() = default;
+		};
+
+		/// type erased slot functor
+		template <class ... Args>
+		class fast_slot
+		{
+			static constexpr std::size_t buffer_size = 2 * sizeof(void *);
+			typedef std::aligned_storage_t<buffer_size, alignof(void *)> buffer_type;
+
+			typedef void (*call_type)(const buffer_type & buffer, Args ... args);
+			typedef void (*destroy_type)(buffer_type & buffer) noexcept;
+
+		private:
+			buffer_type m_buffer;
+			call_type m_call = nullptr;
+			destroy_type m_destroy = nullptr; // null for in place stored functors
+
+		private:
+			template <class Functor>
+			static constexpr bool stored_in_place =
+				    sizeof(Functor) <= buffer_size
+				and alignof(buffer_type) % alignof(Functor) == 0
+				and std::is_trivially_copyable_v<Functor>;
+
+			template <class Functor>
+			static Functor & get_functor(const buffer_type & buffer) noexcept
+			{
+				void * ptr = const_cast<buffer_type *>(&buffer);
+				if constexpr (stored_in_place<Functor>) return *static_cast<Functor *>(ptr);
+				else                                    return **static_cast<Functor **>(ptr);
+			}
+
+			template <class Functor>
+			static void call(const buffer_type & buffer, Args ... args) { get_functor<Functor>(buffer)(args...); }
+
+			template <class Functor>
+			static void destroy(buffer_type & buffer) noexcept { delete &get_functor<Functor>(buffer); }
+
+		public:
+			void operator()(Args ... args) const { m_call(m_buffer, args...); }
+
+		public:
+			template <class Functor, class = std::enable_if_t<not std::is_same_v<std::decay_t<Functor>, fast_slot>>>
+			fast_slot(Functor && func)
+			{
+				typedef std::decay_t<Functor> functor_type;
+				if constexpr (stored_in_place<functor_type>)
+					::new (&m_buffer) functor_type(std::forward<Functor>(func));
+				else
+				{
+					::new (&m_buffer) functor_type *(new functor_type(std::forward<Functor>(func)));
+					m_destroy = &destroy<functor_type>;
+				}
+
+				m_call = &call<functor_type>;
+			}
+
+			// both in place functors and heap pointers are trivially relocatable
+			fast_slot(fast_slot && other) noexcept
+				: m_call(other.m_call), m_destroy(std::exchange(other.m_destroy, nullptr))
+			{
+				std::memcpy(&m_buffer, &other.m_buffer, sizeof(m_buffer));
+			}
+
+			fast_slot & operator =(fast_slot && other) noexcept
+			{
+				if (this != &other)
+				{
+					this->~fast_slot();
+					new (this) fast_slot(std::move(other));
+				}
+
+				return *this;
+			}
+
+			~fast_slot() { if (m_destroy) m_destroy(m_buffer); }
+		};
+	}
+
+	/// non owning connection handle, see fast_signal
+	class fast_connection
+	{
+		template <class Signature> friend class fast_signal;
+
+	private:
+		std::weak_ptr<detail::fast_slot_list_base> m_list;
+		std::uint64_t m_id = 0;
+
+	private:
+		fast_connection(std::weak_ptr<detail::fast_slot_list_base> list, std::uint64_t id) noexcept
+			: m_list(std::move(list)), m_id(id) {}
+
+	public:
+		bool connected() const noexcept
+		{
+			auto list = m_list.lock();
+			return list and list->connected(m_id);
+		}
+
+		void disconnect() const noexcept
+		{
+			if (auto list = m_list.lock())
+				list->disconnect(m_id);
+		}
+
+	public:
+		fast_connection() = default;
+	};
+
+	/// owning connection handle, disconnects on destruction, see fast_signal
+	class fast_scoped_connection : public fast_connection
+	{
+	public:
+		fast_connection release() noexcept { fast_connection con = *this; static_cast<fast_connection &>(*this) = {}; return con; }
+
+	public:
+		fast_scoped_connection() = default;
+		fast_scoped_connection(const fast_connection & con) noexcept : fast_connection(con) {}
+		fast_scoped_connection & operator =(const fast_connection & con) noexcept
+		{
+			disconnect();
+			fast_connection::operator =(con);
+			return *this;
+		}
+
+		fast_scoped_connection(fast_scoped_connection && other) noexcept : fast_connection(other.release()) {}
+		fast_scoped_connection & operator =(fast_scoped_connection && other) noexcept
+		{
+			if (this != &other) *this = other.release();
+			return *this;
+		}
+
+		fast_scoped_connection(const fast_scoped_connection &) = delete;
+		fast_scoped_connection & operator =(const fast_scoped_connection &) = delete;
+
+		~fast_scoped_connection() { disconnect(); }
+	};
+
+	template <class ... Args>
+	class fast_signal<void(Args...)>
+	{
+		typedef detail::fast_slot<Args...> slot_type;
+
+		class slot_list : public detail::fast_slot_list_base
+		{
+			friend fast_signal;
+
+			std::vector<slot_type> m_slots;
+			std::vector<std::pair<std::uint64_t, slot_type>> m_pending; // slots connected while emitting
+
+		protected:
+			void compact() noexcept
+			{
+				std::size_t out = 0;
+				for (std::size_t idx = 0; idx < m_ids.size(); ++idx)
+				{
+					if (not m_ids[idx]) continue;
+					if (out != idx)
+					{
+						m_ids[out] = m_ids[idx];
+						m_slots[out] = std::move(m_slots[idx]);
+					}
+
+					++out;
+				}
+
+				m_ids.resize(out);
+				m_slots.erase(m_slots.begin() + out, m_slots.end());
+
+				for (auto & item : m_pending)
+				{
+					m_ids.push_back(item.first);
+					m_slots.push_back(std::move(item.second));
+				}
+
+				m_pending.clear();
+				m_dirty = false;
+			}
+
+		public:
+			virtual void disconnect(std::uint64_t id) noexcept override
+			{
+				auto it = std::find(m_ids.begin(), m_ids.end(), id);
+				if (it != m_ids.end())
+				{
+					*it = 0;
+					m_dirty = true;
+					if (not m_emitting) compact();
+					return;
+				}
+
+				auto pend = std::find_if(m_pending.begin(), m_pending.end(), [id](auto & item) { return item.first == id; });
+				if (pend != m_pending.end()) m_pending.erase(pend);
+			}
+
+			virtual bool connected(std::uint64_t id) const noexcept override
+			{
+				return find_slot(id) != m_ids.end()
+				    or std::any_of(m_pending.begin(), m_pending.end(), [id](auto & item) { return item.first == id; });
+			}
+
+			~slot_list() = default;
+		};
+
+	private:
+		std::shared_ptr<slot_list> m_list = std::make_shared<slot_list>();
+
+	public:
+		typedef void result_type;
+
+		template <class Functor>
+		fast_connection connect(Functor && func)
+		{
+			auto & list = *m_list;
+			auto id = list.m_next_id++;
+
+			if (list.m_emitting)
+				list.m_pending.emplace_back(id, slot_type(std::forward<Functor>(func)));
+			else
+			{
+				list.m_slots.emplace_back(std::forward<Functor>(func));
+				list.m_ids.push_back(id);
+			}
+
+			return fast_connection(m_list, id);
+		}
+
+		/// calls connected slots in connection order.
+		/// If slot throws - exception is propagated, remaining slots are not called.
+		/// Signal must not be destroyed by it's slots
+		void operator()(Args ... args)
+		{
+			auto & list = *m_list;
+			struct guard
+			{
+				slot_list & list;
+				~guard() { if (not --list.m_emitting and (list.m_dirty or not list.m_pending.empty())) list.compact(); }
+			} g {list};
+
+			++list.m_emitting;
+			// slots and ids are not reallocated or moved while emitting, new slots go to m_pending
+			std::size_t count = list.m_slots.size();
+			for (std::size_t idx = 0; idx < count; ++idx)
+				if (list.m_ids[idx]) list.m_slots[idx](args...);
+		}
+
+		std::size_t num_slots() const noexcept
+		{
+			return m_list->m_pending.size() + std::count_if(m_list->m_ids.begin(), m_list->m_ids.end(), [](auto id) { return id != 0; });
+		}
+
+		bool empty() const noexcept { return num_slots() == 0; }
+
+		void disconnect_all_slots() noexcept
+		{
+			for (auto & id : m_list->m_ids) id = 0;
+			m_list->m_pending.clear();
+			m_list->m_dirty = true;
+			if (not m_list->m_emitting) m_list->compact();
+		}
+
+	public:
+		fast_signal() = default;
+		fast_signal(fast_signal &&) = default;
+		fast_signal & operator =(fast_signal &&) = default;
+
+		fast_signal(const fast_signal &) = delete;
+		fast_signal & operator =(const fast_signal &) = delete;
+	};
+
+	/// Drop-in replacement of default_signal_traits, uses fast_signal instead of boost::signals2.
+	/// Same ranges and signal signatures, but no thread safety at all, no combiners and slot tracking.
+	/// Use it when many views are attached to container and it's updated often with small batches:
+	/// per emission cost is a plain loop over slots, see viewed-benchmarks
+	template <class Type>
+	struct fast_signal_traits : default_signal_traits<Type>
+	{
+		using typename default_signal_traits<Type>::signal_range_type;
+
+		typedef fast_connection          connection;
+		typedef fast_scoped_connection   scoped_connection;
+
+		typedef fast_signal<void(signal_range_type sorted_erased, signal_range_type sorted_updated, signal_range_type inserted)> update_signal_type;
+		typedef fast_signal<void(signal_range_type erased)> erase_signal_type;
+		typedef fast_signal<void()> clear_signal_type;
+	};
+}
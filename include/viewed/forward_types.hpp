@@ -1,7 +1,13 @@
 ﻿#pragma once
+#include <cstdint>
 
 namespace viewed
 {
+	/// bitmask of changed record fields, bits meaning is defined by container traits update and views.
+	/// see associative_conatiner_base::updated_fields
+	typedef std::uint64_t field_mask_type;
+	constexpr field_mask_type all_fields = ~field_mask_type(0);
+
 	/// result of updating filter: should view be completely re-filtered,  incrementally, or not at all
 	enum class refilter_type : unsigned
 	{
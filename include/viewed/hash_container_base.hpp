@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include <vector>
+#include <memory>
+#include <memory_resource>
 #include <viewed/associative_conatiner_base.hpp>
 
 #include <boost/multi_index_container.hpp>
@@ -8,22 +10,26 @@
 
 namespace viewed
 {
-	template <class Type, class Hash, class Equal>
+	template <class Type, class Hash, class Equal, class Allocator = std::allocator<Type>>
 	struct hash_container_traits
 	{
 		typedef Type value_type;
+		/// allocator used by main_store_type for it's nodes and buckets
+		typedef Allocator allocator_type;
+
+		/// main index of store, secondary indexes can be added with indexed_container_traits
+		typedef boost::multi_index::hashed_unique<
+			boost::multi_index::identity<Type>,
+			Hash, Equal
+		> primary_index_type;
 
 		/// container class that stores value_type,
 		/// main_store_type should provide stable pointers/references,
 		/// iterators allowed to be invalidated on modify operations.
 		typedef boost::multi_index_container <
 			value_type,
-			boost::multi_index::indexed_by<
-				boost::multi_index::hashed_unique<
-					boost::multi_index::identity<Type>,
-					Hash, Equal
-				>
-			>
+			boost::multi_index::indexed_by<primary_index_type>,
+			allocator_type
 		> main_store_type;
 
 		/// container type used for storing raw pointers for views notifications
@@ -36,15 +42,18 @@ namespace viewed
 		/// if overloading isn't needed static function members  - will be ok,
 		/// but if you want provide several overloads - use static functors members
 				
-		static main_store_type make_store(Hash hash, Equal eq)
+		/// Store - main_store_type or other multi_index_container with primary_index_type as first index,
+		/// other indexes are default constructed
+		template <class Store = main_store_type>
+		static Store make_store(Hash hash, Equal eq, const allocator_type & alloc = {})
 		{
-			typedef typename main_store_type::ctor_args ctor_args;
+			typedef typename Store::ctor_args ctor_args;
+			typename Store::ctor_args_list args_list;
 			/// The first element of this tuple indicates the minimum number of buckets
 			/// set up by the index on construction time.
 			/// If the default value 0 is used, an implementation defined number is used instead.
-			return main_store_type(
-				ctor_args(0, boost::multi_index::identity<Type>(), std::move(hash), std::move(eq))
-			);
+			args_list.get_head() = ctor_args(0, boost::multi_index::identity<Type>(), std::move(hash), std::move(eq));
+			return Store(args_list, alloc);
 		}
 
 		/// obtains pointer from internal_value_type (from main_store_type)
@@ -58,8 +67,8 @@ namespace viewed
 		static const update_type update;
 	};
 
-	template <class Type, class Hash, class Equal>
-	struct hash_container_traits<Type, Hash, Equal>::update_type
+	template <class Type, class Hash, class Equal, class Allocator>
+	struct hash_container_traits<Type, Hash, Equal, Allocator>::update_type
 	{
 		typedef void result_type;
 		result_type operator()(value_type & val, const value_type & newval) const
@@ -73,9 +82,17 @@ namespace viewed
 		}
 	};
 
+	template <class Type, class Hash, class Equal, class Allocator>
+	const typename hash_container_traits<Type, Hash, Equal, Allocator>::update_type
+		hash_container_traits<Type, Hash, Equal, Allocator>::update = {};
+
+	/// hash_container_traits with polymorphic allocator: store nodes are allocated from std::pmr::memory_resource
+	/// given on container construction, for example:
+	///  * std::pmr::monotonic_buffer_resource - arena for bulk loaded snapshots, memory is released only with the resource itself
+	///  * std::pmr::unsynchronized_pool_resource - size class pools for frequently upserted/erased records
+	/// memory resource must outlive the container
 	template <class Type, class Hash, class Equal>
-	const typename hash_container_traits<Type, Hash, Equal>::update_type
-		hash_container_traits<Type, Hash, Equal>::update = {};
+	using pmr_hash_container_traits = hash_container_traits<Type, Hash, Equal, std::pmr::polymorphic_allocator<Type>>;
 
 
 
@@ -92,7 +109,8 @@ namespace viewed
 	/// @Param Type element type
 	/// @Param Hash functor used to compare elements
 	/// @Param Equal functor used to compare elements
-	/// @Param Traits traits class describes various aspects of hashed container
+	/// @Param Traits traits class describes various aspects of hashed container,
+	///        see also pmr_hash_container_traits for custom store memory allocation
 	template <
 		class Type,
 		class Hash = std::hash<Type>,
@@ -114,10 +132,14 @@ namespace viewed
 
 		using typename base_type::const_iterator;
 		using typename base_type::const_reference;
+		using typename base_type::size_type;
 
 	public:
 		key_equal key_eq() const { return base_type::m_store.key_eq(); }
 		hasher    hash_function() const { return base_type::m_store.hash_function(); }
+
+		/// reserves buckets for count elements, useful before bulk loading, see load_container
+		void reserve(size_type count) { base_type::m_store.reserve(count); }
 		
 		template <class CompatibleKey>
 		std::pair<const_iterator, const_iterator> equal_range(const CompatibleKey & key) const
@@ -131,6 +153,18 @@ namespace viewed
 		hash_container_base(traits_type traits, hasher hash, key_equal eq)
 			: base_type(std::move(traits), std::move(hash), std::move(eq))
 		{ }
+
+		/// constructs container with given store allocator(or it's constructor argument, like std::pmr::memory_resource pointer),
+		/// traits must support it, see hash_container_traits/pmr_hash_container_traits
+		template <class Allocator>
+		hash_container_base(hasher hash, key_equal eq, const Allocator & alloc)
+			: base_type(traits_type {}, std::move(hash), std::move(eq), alloc)
+		{ }
+
+		template <class Allocator>
+		hash_container_base(traits_type traits, hasher hash, key_equal eq, const Allocator & alloc)
+			: base_type(std::move(traits), std::move(hash), std::move(eq), alloc)
+		{ }
 		
 		hash_container_base(const hash_container_base & val) = delete;
 		hash_container_base& operator =(const hash_container_base & val) = delete;
@@ -0,0 +1,60 @@
+#pragma once
+#include <utility>
+#include <type_traits>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index_fwd.hpp>
+#include <boost/multi_index/ordered_index_fwd.hpp>
+#include <boost/multi_index/ranked_index_fwd.hpp>
+
+namespace viewed
+{
+	namespace detail
+	{
+		/// index specifier is unique: hashed_unique, ordered_unique, ranked_unique
+		template <class Index>
+		struct is_unique_index_specifier : std::false_type {};
+
+		template <class... Args>
+		struct is_unique_index_specifier<boost::multi_index::hashed_unique<Args...>> : std::true_type {};
+
+		template <class... Args>
+		struct is_unique_index_specifier<boost::multi_index::ordered_unique<Args...>> : std::true_type {};
+
+		template <class... Args>
+		struct is_unique_index_specifier<boost::multi_index::ranked_unique<Args...>> : std::true_type {};
+	}
+
+	/// traits adapter, adds secondary indexes to store of BaseTraits(hash_container_traits, ordered_container_traits or compatible).
+	/// Indexes - boost::multi_index index specifiers, they should be tagged to be used with find_by/equal_range_by, for example:
+	///   indexed_container_traits<
+	///       hash_container_traits<order, order_hash, order_equal>,
+	///       boost::multi_index::hashed_non_unique<boost::multi_index::tag<by_account>, boost::multi_index::member<order, int, &order::account>>
+	///   >
+	///
+	/// Secondary indexes are kept consistent by container on insert, update and erase:
+	/// updates are done via multi_index modify, so records can be repositioned in secondary indexes.
+	/// Secondary indexes must be non unique - a collision would erase updated record from store, this is checked at compile time.
+	/// BaseTraits must provide primary_index_type, allocator_type and template make_store<Store>(...)
+	template <class BaseTraits, class... Indexes>
+	struct indexed_container_traits : BaseTraits
+	{
+		static_assert((not detail::is_unique_index_specifier<Indexes>::value and ...),
+			"indexed_container_traits: secondary indexes must be non unique");
+
+		typedef typename BaseTraits::value_type           value_type;
+		typedef typename BaseTraits::allocator_type       allocator_type;
+		typedef typename BaseTraits::primary_index_type   primary_index_type;
+
+		typedef boost::multi_index_container <
+			value_type,
+			boost::multi_index::indexed_by<primary_index_type, Indexes...>,
+			allocator_type
+		> main_store_type;
+
+		template <class... Args>
+		static main_store_type make_store(Args && ... args)
+		{
+			return BaseTraits::template make_store<main_store_type>(std::forward<Args>(args)...);
+		}
+	};
+}
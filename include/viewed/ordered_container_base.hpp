@@ -1,5 +1,7 @@
 #pragma once
 #include <vector>
+#include <memory>
+#include <memory_resource>
 #include <viewed/associative_conatiner_base.hpp>
 
 #include <boost/multi_index_container.hpp>
@@ -8,21 +10,25 @@
 
 namespace viewed
 {
-	template <class Type, class Compare>
+	template <class Type, class Compare, class Allocator = std::allocator<Type>>
 	struct ordered_container_traits
 	{
 		typedef Type value_type;
+		/// allocator used by main_store_type for it's nodes
+		typedef Allocator allocator_type;
+
+		/// main index of store, secondary indexes can be added with indexed_container_traits
+		typedef boost::multi_index::ordered_unique<
+			boost::multi_index::identity<Type>, Compare
+		> primary_index_type;
 
 		/// container class that stores value_type,
 		/// main_store_type should provide stable pointers/references,
 		/// iterators allowed to be invalidated on modify operations.
 		typedef boost::multi_index_container <
 			value_type,
-			boost::multi_index::indexed_by<
-				boost::multi_index::ordered_unique<
-					boost::multi_index::identity<Type>, Compare
-				>
-			>
+			boost::multi_index::indexed_by<primary_index_type>,
+			allocator_type
 		> main_store_type;
 
 		/// container type used for storing raw pointers for views notifications
@@ -35,12 +41,15 @@ namespace viewed
 		/// if overloading isn't needed static function members  - will be ok,
 		/// but if you want provide several overloads - use static functors members
 		
-		static main_store_type make_store(Compare comp)
+		/// Store - main_store_type or other multi_index_container with primary_index_type as first index,
+		/// other indexes are default constructed
+		template <class Store = main_store_type>
+		static Store make_store(Compare comp, const allocator_type & alloc = {})
 		{
-			typedef typename main_store_type::ctor_args ctor_args;
-			return main_store_type(
-				ctor_args(boost::multi_index::identity<Type>(), std::move(comp))
-			);
+			typedef typename Store::ctor_args ctor_args;
+			typename Store::ctor_args_list args_list;
+			args_list.get_head() = ctor_args(boost::multi_index::identity<Type>(), std::move(comp));
+			return Store(args_list, alloc);
 		}
 
 		/// obtains pointer from internal_value_type (from main_store_type)
@@ -54,8 +63,8 @@ namespace viewed
 		static const update_type update;
 	};
 
-	template <class Type, class Compare>
-	struct ordered_container_traits<Type, Compare>::update_type
+	template <class Type, class Compare, class Allocator>
+	struct ordered_container_traits<Type, Compare, Allocator>::update_type
 	{
 		typedef void result_type;
 		result_type operator()(value_type & val, const value_type & newval) const
@@ -69,9 +78,15 @@ namespace viewed
 		}
 	};
 
+	template <class Type, class Compare, class Allocator>
+	const typename ordered_container_traits<Type, Compare, Allocator>::update_type
+		ordered_container_traits<Type, Compare, Allocator>::update = {};
+
+	/// ordered_container_traits with polymorphic allocator: store nodes are allocated from std::pmr::memory_resource
+	/// given on container construction, see also pmr_hash_container_traits.
+	/// memory resource must outlive the container
 	template <class Type, class Compare>
-	const typename ordered_container_traits<Type, Compare>::update_type
-		ordered_container_traits<Type, Compare>::update = {};
+	using pmr_ordered_container_traits = ordered_container_traits<Type, Compare, std::pmr::polymorphic_allocator<Type>>;
 
 
 
@@ -87,7 +102,8 @@ namespace viewed
 	/// 
 	/// @Param Type element type
 	/// @Param Compare functor used to test elements for equivalence
-	/// @Param Traits traits class describes various aspects of ordered container
+	/// @Param Traits traits class describes various aspects of ordered container,
+	///        see also pmr_ordered_container_traits for custom store memory allocation
 	template <
 		class Type,
 		class Compare = std::less<>,
@@ -123,10 +139,20 @@ namespace viewed
 
 	public:
 		ordered_container_base(key_compare comp = {})
-			: base_type(base_type::traits_type(), std::move(comp)) {}
+			: base_type(traits_type(), std::move(comp)) {}
 
 		ordered_container_base(traits_type traits, key_compare comp)
 			: base_type(std::move(traits), std::move(comp)) {}
+
+		/// constructs container with given store allocator(or it's constructor argument, like std::pmr::memory_resource pointer),
+		/// traits must support it, see ordered_container_traits/pmr_ordered_container_traits
+		template <class Allocator>
+		ordered_container_base(key_compare comp, const Allocator & alloc)
+			: base_type(traits_type(), std::move(comp), alloc) {}
+
+		template <class Allocator>
+		ordered_container_base(traits_type traits, key_compare comp, const Allocator & alloc)
+			: base_type(std::move(traits), std::move(comp), alloc) {}
 		
 		ordered_container_base(const ordered_container_base & val) = delete;
 		ordered_container_base & operator =(const ordered_container_base & val) = delete;
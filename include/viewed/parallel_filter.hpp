@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+
+#include <viewed/parallel_sort.hpp>
+
+namespace viewed
+{
+	/// Parallel filter evaluation: range is split into chunks, predicate is evaluated on parallel_sort_pool threads
+	/// into pass bitmap, result is compacted in order on calling thread.
+	/// Predicate must be safe to call concurrently from different threads(const and without caches/shared state).
+	/// Pass bitmap is std::vector<char>, not std::vector<bool>: threads write adjacent elements.
+
+	namespace detail
+	{
+		/// chunk for one pool task: small enough for load balancing of uneven predicate cost
+		constexpr std::ptrdiff_t parallel_filter_min_chunk = 1024;
+	}
+
+	/// evaluates pred for every element of [first, last) on pool: passes[idx] = pred(first[idx])
+	template <class RandomAccessIterator, class Pred>
+	void parallel_filter_bitmap(RandomAccessIterator first, RandomAccessIterator last, const Pred & pred,
+	                            std::vector<char> & passes, parallel_sort_pool & pool = default_parallel_sort_pool())
+	{
+		auto size = last - first;
+		passes.resize(size);
+
+		auto chunks = std::min<std::ptrdiff_t>(pool.concurrency() * 4, size / detail::parallel_filter_min_chunk);
+		if (chunks < 2)
+		{
+			std::transform(first, last, passes.begin(), [&pred](auto && val) -> char { return pred(val); });
+			return;
+		}
+
+		pool.run(chunks, [&](std::size_t idx)
+		{
+			auto chunk_first = size * static_cast<std::ptrdiff_t>(idx) / chunks;
+			auto chunk_last  = size * static_cast<std::ptrdiff_t>(idx + 1) / chunks;
+
+			for (auto pos = chunk_first; pos != chunk_last; ++pos)
+				passes[pos] = pred(first[pos]);
+		});
+	}
+
+	/// moves elements of [first, last) with passes[idx] set to front, preserving order, as std::remove_if. returns new end
+	template <class RandomAccessIterator>
+	RandomAccessIterator compact_by_bitmap(RandomAccessIterator first, RandomAccessIterator last, const std::vector<char> & passes)
+	{
+		auto out = first;
+		for (auto pass = passes.begin(); first != last; ++first, ++pass)
+			if (*pass) *out++ = std::move(*first);
+
+		return out;
+	}
+
+	/// removes elements of [first, last) not passing pred, preserving order, as std::remove_if with negated pred.
+	/// pred is evaluated in parallel, see parallel_filter_bitmap
+	template <class RandomAccessIterator, class Pred>
+	RandomAccessIterator parallel_filter(RandomAccessIterator first, RandomAccessIterator last, const Pred & pred,
+	                                     parallel_sort_pool & pool = default_parallel_sort_pool())
+	{
+		std::vector<char> passes;
+		parallel_filter_bitmap(first, last, pred, passes, pool);
+		return compact_by_bitmap(first, last, passes);
+	}
+}
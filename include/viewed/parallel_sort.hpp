@@ -0,0 +1,332 @@
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+
+#include <varalgo/std_variant_traits.hpp>
+
+namespace viewed
+{
+	/// Simple fixed size thread pool for parallel sorting algorithms.
+	/// Only one kind of job is supported: run(count, func) calls func(idx) for every idx in [0, count),
+	/// spreading calls over pool threads and calling thread, and waits until all calls are done.
+	/// Calling thread always participates, pool threads never wait for other jobs - so run can't deadlock,
+	/// even when called from different threads simultaneously.
+	class parallel_sort_pool
+	{
+		struct job_state
+		{
+			std::atomic<std::size_t> next {0};
+			std::size_t count;
+			const std::function<void(std::size_t)> * func;
+
+			std::mutex mutex;
+			std::condition_variable done_var;
+			std::size_t done = 0;
+			std::exception_ptr error;
+
+			void execute() noexcept;
+		};
+
+	private:
+		std::vector<std::thread> m_threads;
+		std::deque<std::shared_ptr<job_state>> m_jobs;
+		std::mutex m_mutex;
+		std::condition_variable m_jobs_var;
+		bool m_stopped = false;
+
+	private:
+		void thread_loop();
+
+	public:
+		/// number of threads participating in run, including calling thread
+		std::size_t concurrency() const noexcept { return m_threads.size() + 1; }
+
+		/// calls func(idx) for idx in [0, count) in parallel and waits for completion.
+		/// If some call throws - first exception is rethrown after all calls are done
+		void run(std::size_t count, const std::function<void(std::size_t)> & func);
+
+	public:
+		/// creates pool with threads - 1 worker threads, 0 - std::thread::hardware_concurrency
+		explicit parallel_sort_pool(std::size_t threads = 0);
+		~parallel_sort_pool();
+
+		parallel_sort_pool(const parallel_sort_pool &) = delete;
+		parallel_sort_pool & operator =(const parallel_sort_pool &) = delete;
+	};
+
+	/// process wide pool used by default, created on first use
+	inline parallel_sort_pool & default_parallel_sort_pool()
+	{
+		static parallel_sort_pool pool;
+		return pool;
+	}
+
+	inline void parallel_sort_pool::job_state::execute() noexcept
+	{
+		std::size_t executed = 0;
+		for (std::size_t idx = next++; idx < count; idx = next++, ++executed)
+		{
+			try
+			{
+				(*func)(idx);
+			}
+			catch (...)
+			{
+				std::lock_guard lk(mutex);
+				if (not error) error = std::current_exception();
+			}
+		}
+
+		if (not executed) return;
+
+		std::lock_guard lk(mutex);
+		done += executed;
+		if (done == count) done_var.notify_all();
+	}
+
+	inline parallel_sort_pool::parallel_sort_pool(std::size_t threads)
+	{
+		if (not threads) threads = std::max(1u, std::thread::hardware_concurrency());
+
+		m_threads.reserve(threads - 1);
+		for (std::size_t idx = 1; idx < threads; ++idx)
+			m_threads.emplace_back(&parallel_sort_pool::thread_loop, this);
+	}
+
+	inline parallel_sort_pool::~parallel_sort_pool()
+	{
+		{
+			std::lock_guard lk(m_mutex);
+			m_stopped = true;
+		}
+
+		m_jobs_var.notify_all();
+		for (auto & thread : m_threads)
+			thread.join();
+	}
+
+	inline void parallel_sort_pool::thread_loop()
+	{
+		for (;;)
+		{
+			std::shared_ptr<job_state> job;
+			{
+				std::unique_lock lk(m_mutex);
+				m_jobs_var.wait(lk, [this] { return m_stopped or not m_jobs.empty(); });
+				if (m_jobs.empty()) return;
+
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+
+			job->execute();
+		}
+	}
+
+	inline void parallel_sort_pool::run(std::size_t count, const std::function<void(std::size_t)> & func)
+	{
+		if (count == 0) return;
+		if (count == 1 or m_threads.empty())
+		{
+			for (std::size_t idx = 0; idx < count; ++idx) func(idx);
+			return;
+		}
+
+		// job state is shared: helpers started after all calls are done just find no work,
+		// they never touch func in that case
+		auto job = std::make_shared<job_state>();
+		job->count = count;
+		job->func = &func;
+
+		auto helpers = std::min(count - 1, m_threads.size());
+		{
+			std::lock_guard lk(m_mutex);
+			m_jobs.insert(m_jobs.end(), helpers, job);
+		}
+
+		if (helpers == 1) m_jobs_var.notify_one();
+		else              m_jobs_var.notify_all();
+
+		job->execute();
+
+		std::unique_lock lk(job->mutex);
+		job->done_var.wait(lk, [&job] { return job->done == job->count; });
+		if (job->error) std::rethrow_exception(job->error);
+	}
+
+	namespace detail
+	{
+		/// ranges shorter than this are not worth splitting between threads
+		constexpr std::ptrdiff_t parallel_sort_min_chunk = 16 * 1024;
+
+		/// merge path split: number of elements taken from [first1, first1 + size1) among first diag elements
+		/// of stable merge of it with [first2, first2 + size2), elements from first range go first on ties
+		template <class Iterator1, class Iterator2, class Compare>
+		std::ptrdiff_t merge_path_split(Iterator1 first1, std::ptrdiff_t size1, Iterator2 first2, std::ptrdiff_t size2, std::ptrdiff_t diag, Compare & comp)
+		{
+			auto lo = std::max<std::ptrdiff_t>(0, diag - size2);
+			auto hi = std::min(diag, size1);
+
+			while (lo < hi)
+			{
+				auto idx = lo + (hi - lo) / 2;
+				// first1[idx] is not greater than first2[diag - idx - 1] - it must be taken too
+				if (not comp(first2[diag - idx - 1], first1[idx])) lo = idx + 1;
+				else                                               hi = idx;
+			}
+
+			return lo;
+		}
+
+		/// stable merge of [first1, last1) and [first2, last2) into out, elements are moved
+		template <class Iterator1, class Iterator2, class OutIterator, class Compare>
+		void move_merge(Iterator1 first1, Iterator1 last1, Iterator2 first2, Iterator2 last2, OutIterator out, Compare & comp)
+		{
+			for (; first1 != last1 and first2 != last2; ++out)
+			{
+				if (comp(*first2, *first1)) *out = std::move(*first2++);
+				else                        *out = std::move(*first1++);
+			}
+
+			out = std::move(first1, last1, out);
+			std::move(first2, last2, out);
+		}
+
+		/// one round of parallel merge sort: merges adjacent runs pairwise from src to dst.
+		/// runs - run boundaries, updated to boundaries of merged runs.
+		/// Every pair is split via merge path into parts, so all threads are busy even for last round with one pair
+		template <class SrcIterator, class DstIterator, class Compare>
+		void parallel_merge_round(SrcIterator src, DstIterator dst, std::vector<std::ptrdiff_t> & runs, Compare & comp, parallel_sort_pool & pool)
+		{
+			struct task { std::ptrdiff_t first, middle, last, out_first, out_last; };
+
+			std::vector<std::ptrdiff_t> merged;
+			std::vector<task> tasks;
+			auto pairs = (runs.size() - 1) / 2;
+			auto parts = std::max<std::size_t>(1, pool.concurrency() / std::max<std::size_t>(1, pairs));
+
+			for (std::size_t idx = 0; idx + 1 < runs.size(); idx += 2)
+			{
+				merged.push_back(runs[idx]);
+
+				auto first = runs[idx];
+				auto middle = runs[idx + 1];
+				auto last = idx + 2 < runs.size() ? runs[idx + 2] : middle;
+
+				for (std::size_t part = 0; part < parts; ++part)
+				{
+					auto out_first = first + (last - first) * static_cast<std::ptrdiff_t>(part) / static_cast<std::ptrdiff_t>(parts);
+					auto out_last  = first + (last - first) * static_cast<std::ptrdiff_t>(part + 1) / static_cast<std::ptrdiff_t>(parts);
+					if (out_first != out_last) tasks.push_back({first, middle, last, out_first, out_last});
+				}
+			}
+
+			merged.push_back(runs.back());
+			runs = std::move(merged);
+
+			pool.run(tasks.size(), [&](std::size_t idx)
+			{
+				auto & t = tasks[idx];
+				auto size1 = t.middle - t.first, size2 = t.last - t.middle;
+				auto split1 = detail::merge_path_split(src + t.first, size1, src + t.middle, size2, t.out_first - t.first, comp);
+				auto split2 = detail::merge_path_split(src + t.first, size1, src + t.middle, size2, t.out_last - t.first, comp);
+
+				detail::move_merge(
+					src + t.first + split1, src + t.first + split2,
+					src + t.middle + (t.out_first - t.first - split1), src + t.middle + (t.out_last - t.first - split2),
+					dst + t.out_first, comp);
+			});
+		}
+
+		template <class RandomAccessIterator, class Compare>
+		void parallel_stable_sort(RandomAccessIterator first, RandomAccessIterator last, Compare & comp, parallel_sort_pool & pool)
+		{
+			using value_type = typename std::iterator_traits<RandomAccessIterator>::value_type;
+
+			auto size = last - first;
+			auto chunks = std::min<std::ptrdiff_t>(pool.concurrency(), size / parallel_sort_min_chunk);
+			if (chunks < 2) return std::stable_sort(first, last, comp);
+
+			std::vector<std::ptrdiff_t> runs(chunks + 1);
+			for (std::ptrdiff_t idx = 0; idx <= chunks; ++idx)
+				runs[idx] = size * idx / chunks;
+
+			pool.run(chunks, [&](std::size_t idx) { std::stable_sort(first + runs[idx], first + runs[idx + 1], comp); });
+
+			// merge rounds, ping-pong between range and buffer.
+			// buffer is copy constructed, value_type may be not default constructible(like QCollatorSortKey)
+			std::vector<value_type> buffer(first, last);
+			bool in_buffer = false;
+			while (runs.size() > 2)
+			{
+				if (in_buffer) parallel_merge_round(buffer.begin(), first, runs, comp, pool);
+				else           parallel_merge_round(first, buffer.begin(), runs, comp, pool);
+				in_buffer = not in_buffer;
+			}
+
+			if (in_buffer)
+			{
+				pool.run(chunks, [&](std::size_t idx)
+				{
+					auto part_first = size * static_cast<std::ptrdiff_t>(idx) / chunks;
+					auto part_last  = size * static_cast<std::ptrdiff_t>(idx + 1) / chunks;
+					std::move(buffer.begin() + part_first, buffer.begin() + part_last, first + part_first);
+				});
+			}
+		}
+
+		template <class RandomAccessIterator, class Compare>
+		void parallel_inplace_merge(RandomAccessIterator first, RandomAccessIterator middle, RandomAccessIterator last, Compare & comp, parallel_sort_pool & pool)
+		{
+			using value_type = typename std::iterator_traits<RandomAccessIterator>::value_type;
+
+			auto size = last - first;
+			auto chunks = std::min<std::ptrdiff_t>(pool.concurrency(), size / parallel_sort_min_chunk);
+			if (chunks < 2 or first == middle or middle == last) return std::inplace_merge(first, middle, last, comp);
+
+			std::vector<value_type> buffer(first, last);
+			pool.run(chunks, [&](std::size_t idx)
+			{
+				auto part_first = size * static_cast<std::ptrdiff_t>(idx) / chunks;
+				auto part_last  = size * static_cast<std::ptrdiff_t>(idx + 1) / chunks;
+				std::move(first + part_first, first + part_last, buffer.begin() + part_first);
+			});
+
+			std::vector<std::ptrdiff_t> runs = {0, middle - first, size};
+			parallel_merge_round(buffer.begin(), first, runs, comp, pool);
+		}
+	}
+
+	/// Parallel stable sort: range is split into pool.concurrency() chunks, those are sorted with std::stable_sort in parallel,
+	/// than merged pairwise, with every merge split between threads via merge path.
+	/// Same result as std::stable_sort, ranges with less than 2 chunks of parallel_sort_min_chunk are just std::stable_sort'ed.
+	/// Works with proxy iterators(zip iterators), value_type must be copy constructible from range elements and move assignable,
+	/// default constructor is not needed(QCollatorSortKey is fine).
+	/// comp can be a variant of predicates(see varalgo::variant_traits)
+	template <class RandomAccessIterator, class Compare>
+	void parallel_stable_sort(RandomAccessIterator first, RandomAccessIterator last, const Compare & comp, parallel_sort_pool & pool = default_parallel_sort_pool())
+	{
+		auto alg = [&](auto & comp) { detail::parallel_stable_sort(first, last, comp, pool); };
+		varalgo::variant_traits<Compare>::visit(alg, comp);
+	}
+
+	/// Parallel std::inplace_merge, stable: elements from [first, middle) go first on ties.
+	/// Uses buffer of last - first elements, see also parallel_stable_sort
+	template <class RandomAccessIterator, class Compare>
+	void parallel_inplace_merge(RandomAccessIterator first, RandomAccessIterator middle, RandomAccessIterator last, const Compare & comp, parallel_sort_pool & pool = default_parallel_sort_pool())
+	{
+		auto alg = [&](auto & comp) { detail::parallel_inplace_merge(first, middle, last, comp, pool); };
+		varalgo::variant_traits<Compare>::visit(alg, comp);
+	}
+}
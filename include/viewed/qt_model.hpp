@@ -34,4 +34,39 @@ namespace viewed
 		static const QList<QPersistentModelIndex> empty_model_list;
 		static const QVector<int>                 all_roles;
 	};
+
+	/// Accumulates persistent index changes, so they can be applied with one changePersistentIndexList call,
+	/// instead of changePersistentIndex per index(each of those searches model persistent index storage).
+	/// Not moved indexes are skipped.
+	class persistent_index_remap
+	{
+		QModelIndexList m_from, m_to;
+
+	public:
+		void reserve(int size) { m_from.reserve(size); m_to.reserve(size); }
+		bool empty() const noexcept { return m_from.isEmpty(); }
+		void clear() noexcept { m_from.clear(); m_to.clear(); }
+
+		/// to - new index, invalid one if index should be removed
+		void add(const QModelIndex & from, const QModelIndex & to)
+		{
+			if (from == to) return;
+			m_from.push_back(from);
+			m_to.push_back(to);
+		}
+
+		const QModelIndexList & from() const noexcept { return m_from; }
+		const QModelIndexList & to()   const noexcept { return m_to; }
+
+		/// applies accumulated changes via model.changePersistentIndexList and clears them,
+		/// model should provide public changePersistentIndexList, see AbstractItemModel
+		template <class Model>
+		void apply(Model & model)
+		{
+			if (empty()) return;
+
+			model.changePersistentIndexList(m_from, m_to);
+			clear();
+		}
+	};
 }
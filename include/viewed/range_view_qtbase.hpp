@@ -0,0 +1,325 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+
+#include <boost/iterator/transform_iterator.hpp>
+#include <viewed/view_qtbase.hpp>
+
+namespace viewed
+{
+	/// Materialized key range view over ordered container(ordered_container_base or compatible),
+	/// see also view_qtbase description for more information.
+	///
+	/// View holds records with keys in [lower, upper) in container order.
+	/// It's seeded via container lower_bound, on updates only incoming records are tested against bounds,
+	/// so cost of update does not depend on container size. Range can be moved incrementally via set_range/slide:
+	/// only records leaving/entering window are touched, with qt beginRemoveRows/beginInsertRows signals.
+	///
+	/// Container must provide key_comp, lower_bound(key), and it's compare should support (value_type, key_type),
+	/// (key_type, value_type) and (key_type, key_type) comparisons, for example with std::less<> and record comparison operators.
+	/// Records keys must not change on update(true for ordered_container_base).
+	///
+	/// @Param Container - ordered container this view is attached to
+	/// @Param Key - type of range bounds, value_type by default
+	template <class Container, class Key = typename Container::value_type>
+	class range_view_qtbase : public view_qtbase<Container>
+	{
+		typedef view_qtbase<Container>                 base_type;
+		typedef range_view_qtbase<Container, Key>      self_type;
+
+	public:
+		using typename base_type::container_type;
+		using typename base_type::view_pointer_type;
+		using typename base_type::value_type;
+
+		typedef Key                                    key_type;
+		typedef typename container_type::key_compare   key_compare;
+
+	protected:
+		using typename base_type::store_type;
+		using typename base_type::signal_range_type;
+		using typename base_type::model_type;
+		using typename base_type::int_vector;
+		using typename base_type::field_mask_vector;
+
+		using base_type::m_owner;
+		using base_type::m_store;
+		using base_type::get_model;
+		using base_type::get_view_pointer;
+		using base_type::change_indexes;
+		using base_type::emit_changed;
+
+	protected:
+		key_type m_lower, m_upper;
+
+	public:
+		/// range bounds: view holds records with keys in [lower; upper)
+		const key_type & lower() const noexcept { return m_lower; }
+		const key_type & upper() const noexcept { return m_upper; }
+
+		/// moves range to [lower; upper), only records leaving or entering range are processed.
+		/// emits qt beginRemoveRows/beginInsertRows signals
+		void set_range(key_type lower, key_type upper);
+		/// moves range by delta: [lower + delta; upper + delta), see set_range
+		template <class Delta>
+		void slide(const Delta & delta) { set_range(m_lower + delta, m_upper + delta); }
+
+		/// reinitializes view from container range [lower_bound(lower); lower_bound(upper))
+		virtual void reinit_view() override;
+
+	protected:
+		bool empty_range() const { return not m_owner->key_comp()(m_lower, m_upper); }
+		bool in_range(const value_type & rec) const;
+		/// finds position of record in m_store via binary search
+		auto find_row(const value_type & rec) const -> typename store_type::const_iterator;
+
+		/// removes rows [first; last), emits qt signals
+		void remove_rows(int first, int last);
+		/// inserts view pointers [first; last) at row, emits qt signals
+		template <class Iterator>
+		void insert_rows(int row, Iterator first, Iterator last);
+		/// inserts owner records [first; last) at row, emits qt signals
+		template <class Iterator>
+		void insert_records(int row, Iterator first, Iterator last)
+		{
+			insert_rows(row, boost::make_transform_iterator(first, get_view_pointer), boost::make_transform_iterator(last, get_view_pointer));
+		}
+
+		/// removes rows erased_rows(sorted) and inserts new_records(sorted by key), emits qt signals
+		void apply_changes(const int_vector & erased_rows, const store_type & new_records);
+
+	protected:
+		/// emits dataChanged for updated records in range, removes erased and inserts new ones passing bounds
+		virtual void update_data(
+			const signal_range_type & sorted_erased,
+			const signal_range_type & sorted_updated,
+			const signal_range_type & inserted) override;
+
+		virtual void erase_records(const signal_range_type & sorted_erased) override;
+
+	public:
+		range_view_qtbase(container_type * owner, key_type lower, key_type upper)
+			: base_type(owner), m_lower(std::move(lower)), m_upper(std::move(upper)) {}
+
+		range_view_qtbase(const range_view_qtbase &) = delete;
+		range_view_qtbase & operator =(const range_view_qtbase &) = delete;
+	};
+
+	template <class Container, class Key>
+	bool range_view_qtbase<Container, Key>::in_range(const value_type & rec) const
+	{
+		auto comp = m_owner->key_comp();
+		return not comp(rec, m_lower) and comp(rec, m_upper);
+	}
+
+	template <class Container, class Key>
+	auto range_view_qtbase<Container, Key>::find_row(const value_type & rec) const -> typename store_type::const_iterator
+	{
+		auto comp = m_owner->key_comp();
+		auto less = [&comp](view_pointer_type ptr, const value_type & rec) { return comp(*ptr, rec); };
+		return std::lower_bound(m_store.begin(), m_store.end(), rec, less);
+	}
+
+	template <class Container, class Key>
+	void range_view_qtbase<Container, Key>::reinit_view()
+	{
+		auto * model = get_model();
+		model->beginResetModel();
+
+		m_store.clear();
+		if (not empty_range())
+		{
+			auto first = m_owner->lower_bound(m_lower);
+			auto last  = m_owner->lower_bound(m_upper);
+			std::transform(first, last, std::back_inserter(m_store), get_view_pointer);
+		}
+
+		this->invalidate_row_index();
+		model->endResetModel();
+	}
+
+	template <class Container, class Key>
+	void range_view_qtbase<Container, Key>::remove_rows(int first, int last)
+	{
+		if (first == last) return;
+
+		auto * model = get_model();
+		model->beginRemoveRows(model_type::invalid_index, first, last - 1);
+		if (first == 0) this->row_index_front_removed(last);
+		else            this->invalidate_row_index();
+
+		m_store.erase(m_store.begin() + first, m_store.begin() + last);
+		model->endRemoveRows();
+	}
+
+	template <class Container, class Key>
+	template <class Iterator>
+	void range_view_qtbase<Container, Key>::insert_rows(int row, Iterator first, Iterator last)
+	{
+		auto count = static_cast<int>(std::distance(first, last));
+		if (count == 0) return;
+
+		auto * model = get_model();
+		model->beginInsertRows(model_type::invalid_index, row, row + count - 1);
+		m_store.insert(m_store.begin() + row, first, last);
+		if (row + count == static_cast<int>(m_store.size())) this->row_index_appended(row);
+		else                                                 this->invalidate_row_index();
+		model->endInsertRows();
+	}
+
+	template <class Container, class Key>
+	void range_view_qtbase<Container, Key>::set_range(key_type lower, key_type upper)
+	{
+		m_lower = std::move(lower);
+		m_upper = std::move(upper);
+
+		auto comp = m_owner->key_comp();
+		auto less = [&comp](view_pointer_type ptr, const key_type & key) { return comp(*ptr, key); };
+		bool empty = empty_range();
+
+		// records before new lower bound
+		auto first = m_store.begin();
+		auto last  = m_store.end();
+		auto front_last = empty ? last : std::lower_bound(first, last, m_lower, less);
+		remove_rows(0, static_cast<int>(front_last - first));
+
+		// records after new upper bound
+		first = m_store.begin();
+		last  = m_store.end();
+		auto back_first = std::lower_bound(first, last, m_upper, less);
+		remove_rows(static_cast<int>(back_first - first), static_cast<int>(last - first));
+
+		if (empty) return;
+
+		auto cfirst = m_owner->lower_bound(m_lower);
+		auto clast  = m_owner->lower_bound(m_upper);
+		if (m_store.empty())
+			return insert_records(0, cfirst, clast);
+
+		// records between new bounds and records left in view
+		auto front = m_owner->lower_bound(*m_store.front());
+		auto back  = std::next(m_owner->lower_bound(*m_store.back()));
+
+		insert_records(0, cfirst, front);
+		insert_records(static_cast<int>(m_store.size()), back, clast);
+	}
+
+	template <class Container, class Key>
+	void range_view_qtbase<Container, Key>::update_data(
+		const signal_range_type & sorted_erased,
+		const signal_range_type & sorted_updated,
+		const signal_range_type & inserted)
+	{
+		// keys are not changed on update, updated records stay in or out of range
+		if (not sorted_updated.empty())
+		{
+			auto fields = this->updated_fields();
+			bool use_fields = fields.size() == sorted_updated.size();
+			std::vector<std::pair<int, field_mask_type>> changed;
+
+			for (std::size_t idx = 0; idx < sorted_updated.size(); ++idx)
+			{
+				auto * ptr = sorted_updated[idx];
+				if (not in_range(*ptr)) continue;
+
+				auto it = find_row(*ptr);
+				if (it == m_store.end() or *it != ptr) continue;
+
+				changed.emplace_back(static_cast<int>(it - m_store.begin()), use_fields ? fields[idx] : all_fields);
+			}
+
+			std::sort(changed.begin(), changed.end());
+
+			int_vector rows;
+			field_mask_vector rows_fields;
+			for (auto & item : changed)
+			{
+				rows.push_back(item.first);
+				rows_fields.push_back(item.second);
+			}
+
+			if (use_fields) emit_changed(rows.cbegin(), rows.cend(), rows_fields.cbegin());
+			else            emit_changed(rows.cbegin(), rows.cend());
+		}
+
+		int_vector erased_rows;
+		for (auto * ptr : sorted_erased)
+		{
+			if (not in_range(*ptr)) continue;
+
+			auto it = find_row(*ptr);
+			if (it != m_store.end() and *it == ptr)
+				erased_rows.push_back(static_cast<int>(it - m_store.begin()));
+		}
+
+		std::sort(erased_rows.begin(), erased_rows.end());
+
+		store_type new_records;
+		for (auto * ptr : inserted)
+			if (in_range(*ptr)) new_records.push_back(ptr);
+
+		auto comp = m_owner->key_comp();
+		std::sort(new_records.begin(), new_records.end(), [&comp](auto * p1, auto * p2) { return comp(*p1, *p2); });
+
+		apply_changes(erased_rows, new_records);
+	}
+
+	template <class Container, class Key>
+	void range_view_qtbase<Container, Key>::erase_records(const signal_range_type & sorted_erased)
+	{
+		signal_range_type none;
+		update_data(sorted_erased, none, none);
+	}
+
+	template <class Container, class Key>
+	void range_view_qtbase<Container, Key>::apply_changes(const int_vector & erased_rows, const store_type & new_records)
+	{
+		if (erased_rows.empty() and new_records.empty()) return;
+
+		auto comp = m_owner->key_comp();
+		int size = static_cast<int>(m_store.size());
+
+		// common cases: records appended after last one, or contiguous block removed, like window tail/head
+		if (erased_rows.empty() and (m_store.empty() or comp(*m_store.back(), *new_records.front())))
+			return insert_rows(size, new_records.begin(), new_records.end());
+
+		if (new_records.empty() and erased_rows.back() - erased_rows.front() + 1 == static_cast<int>(erased_rows.size()))
+			return remove_rows(erased_rows.front(), erased_rows.back() + 1);
+
+		// general case: merge, build old row -> new row map for persistent indexes
+		auto * model = get_model();
+		Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+
+		store_type store;
+		store.reserve(m_store.size() - erased_rows.size() + new_records.size());
+		int_vector index_map(size);
+
+		auto erased_it = erased_rows.begin();
+		auto new_it = new_records.begin();
+
+		for (int row = 0; row < size; ++row)
+		{
+			if (erased_it != erased_rows.end() and *erased_it == row)
+			{
+				index_map[row] = -1;
+				++erased_it;
+				continue;
+			}
+
+			auto * ptr = m_store[row];
+			for (; new_it != new_records.end() and comp(**new_it, *ptr); ++new_it)
+				store.push_back(*new_it);
+
+			index_map[row] = static_cast<int>(store.size());
+			store.push_back(ptr);
+		}
+
+		store.insert(store.end(), new_it, new_records.end());
+		m_store = std::move(store);
+		change_indexes(index_map.begin(), index_map.end(), 0);
+
+		Q_EMIT model->layoutChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+	}
+}
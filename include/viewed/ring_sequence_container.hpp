@@ -0,0 +1,245 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <boost/circular_buffer.hpp>
+
+#include <viewed/sequence_container.hpp>
+
+namespace viewed
+{
+	/// ring_sequence_container traits. Elements stored in boost::circular_buffer<std::unique_ptr<Type>>
+	template <class Type>
+	struct ring_sequence_container_traits
+	{
+		using internal_value_type = std::unique_ptr<Type>;
+		using main_store_type     = boost::circular_buffer<internal_value_type>;
+		using signal_store_type   = std::vector<const Type *>;
+
+		static main_store_type make_store()                  { return main_store_type(); }
+		static auto make_internal(Type && val)               { return std::make_unique<Type>(std::move(val)); }
+		static auto make_internal(const Type & val)          { return std::make_unique<Type>(val); }
+
+		static decltype(auto) value_reference(const internal_value_type & val) { return (*val); }
+		static decltype(auto) value_reference(      internal_value_type & val) { return (*val); }
+
+		static auto value_pointer(const internal_value_type & val) { return val.get(); }
+		static auto value_pointer(      internal_value_type & val) { return val.get(); }
+	};
+
+	/// Capacity bounded sequence_container, backed by ring buffer: log like sources, event journals, etc.
+	/// When append exceeds capacity - oldest records are evicted, with one erase signal, before new records are appended.
+	/// Eviction does not shift store: it's just a ring buffer head move.
+	/// Views receive erase signal with contiguous leading block of records,
+	/// view_qtbase translates that into single beginRemoveRows(0, k - 1).
+	///
+	/// While batch is active evicted records are kept in store until batch ends(see sequence_container::begin_batch),
+	/// store grows beyond capacity if needed. Same for assign: old records are kept until views are notified.
+	///
+	/// @Param Type element type
+	/// @Param Traits traits class, should have main_store_type with boost::circular_buffer interface
+	/// @Param SignalTraits traits class describes various aspects of signaling, see default_signal_traits
+	template <
+		class Type,
+		class Traits = ring_sequence_container_traits<Type>,
+		class SignalTraits = default_signal_traits<Type>
+	>
+	class ring_sequence_container : public sequence_container<Type, Traits, SignalTraits>
+	{
+		using self_type = ring_sequence_container<Type, Traits, SignalTraits>;
+		using base_type = sequence_container<Type, Traits, SignalTraits>;
+
+	protected:
+		using typename base_type::traits_type;
+		using typename base_type::signal_store_type;
+
+		using base_type::m_store;
+		using base_type::m_batch_depth;
+		using base_type::m_batch_erased;
+		using base_type::get_pointer;
+
+	public:
+		using typename base_type::value_type;
+		using typename base_type::size_type;
+		using typename base_type::const_iterator;
+
+	protected:
+		size_type m_capacity;
+
+	protected:
+		/// number of records, not pending erase in active batch
+		size_type live_size() const noexcept { return m_store.size() - m_batch_erased.size(); }
+		/// makes sure store can hold count more records without overwriting
+		void reserve_store(size_type count);
+
+	public:
+		/// maximum number of records in container
+		size_type capacity() const noexcept { return m_capacity; }
+		/// changes capacity, evicts oldest records if there are more than new capacity
+		void set_capacity(size_type capacity);
+
+		/// erases count oldest records(or all if there are less), views are notified with one erase signal
+		void evict(size_type count);
+
+		/// erases elements [first, last) from internal store and views.
+		/// Store is shifted from nearest end: erasing leading records is O(count)
+		const_iterator erase(const_iterator first, const_iterator last);
+		const_iterator erase(const_iterator it) { return erase(it, std::next(it)); }
+
+		/// appends records from [first, last), if capacity is exceeded - oldest records are evicted first.
+		/// If there are more new records than capacity - only last capacity ones are appended
+		template <class SinglePassIterator>
+		void append(SinglePassIterator first, SinglePassIterator last);
+		void append(std::initializer_list<value_type> ilist) { append(std::begin(ilist), std::end(ilist)); }
+
+		/// clear container and assigns last capacity elements from [first, last)
+		template <class SinglePassIterator>
+		void assign(SinglePassIterator first, SinglePassIterator last);
+		void assign(std::initializer_list<value_type> ilist) { assign(std::begin(ilist), std::end(ilist)); }
+
+		template <class Arg> void append(Arg && arg) { append(&arg, &arg + 1); }
+		template <class Arg> void push_back(Arg && arg) { return append(std::forward<Arg>(arg)); }
+
+	public:
+		explicit ring_sequence_container(size_type capacity, traits_type traits = {})
+			: base_type(std::move(traits)), m_capacity(capacity)
+		{
+			m_store.set_capacity(capacity);
+		}
+
+		ring_sequence_container(ring_sequence_container && op) = default;
+		ring_sequence_container & operator =(ring_sequence_container && op) = default;
+	};
+
+	template <class Type, class Traits, class SignalTraits>
+	void ring_sequence_container<Type, Traits, SignalTraits>::reserve_store(size_type count)
+	{
+		if (m_store.size() + count > m_store.capacity())
+			m_store.set_capacity(std::max(m_capacity, m_store.size() + count));
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	void ring_sequence_container<Type, Traits, SignalTraits>::set_capacity(size_type capacity)
+	{
+		auto size = live_size();
+		if (size > capacity) evict(size - capacity);
+
+		m_capacity = capacity;
+		if (not m_batch_depth and m_store.capacity() != std::max(capacity, m_store.size()))
+			m_store.set_capacity(std::max(capacity, m_store.size()));
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	void ring_sequence_container<Type, Traits, SignalTraits>::evict(size_type count)
+	{
+		count = std::min(count, live_size());
+		if (not count) return;
+
+		if (not m_batch_depth)
+		{
+			base_type::erase_from_views(this->begin(), this->begin() + count);
+			m_store.erase_begin(count);
+			return;
+		}
+
+		// oldest records, which are not already erased in this batch
+		signal_store_type erased, none;
+		erased.reserve(count);
+
+		for (auto it = m_store.begin(); erased.size() < count; ++it)
+		{
+			auto * ptr = get_pointer(*it);
+			if (not std::binary_search(m_batch_erased.begin(), m_batch_erased.end(), ptr))
+				erased.push_back(ptr);
+		}
+
+		base_type::gather_batch(erased, none, none);
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	auto ring_sequence_container<Type, Traits, SignalTraits>::erase(const_iterator first, const_iterator last) -> const_iterator
+	{
+		if (m_batch_depth)
+		{
+			// records are erased from store when batch ends
+			signal_store_type erased, none;
+			std::transform(first, last, std::back_inserter(erased), base_type::get_view_pointer);
+			base_type::gather_batch(erased, none, none);
+			return last;
+		}
+
+		auto first_pos = first - this->cbegin();
+		auto last_pos  = last - this->cbegin();
+		if (first_pos == last_pos) return last;
+
+		base_type::erase_from_views(first, last);
+
+		auto store_first = m_store.begin() + first_pos;
+		auto store_last  = m_store.begin() + last_pos;
+
+		// shift shorter part of ring
+		if (first_pos < static_cast<decltype(first_pos)>(m_store.size()) - last_pos)
+			m_store.rerase(store_first, store_last);
+		else
+			m_store.erase(store_first, store_last);
+
+		return this->cbegin() + first_pos;
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	template <class SinglePassIterator>
+	void ring_sequence_container<Type, Traits, SignalTraits>::append(SinglePassIterator first, SinglePassIterator last)
+	{
+		using category = typename std::iterator_traits<SinglePassIterator>::iterator_category;
+		if constexpr (not std::is_base_of_v<std::forward_iterator_tag, category>)
+		{
+			std::vector<value_type> records(first, last);
+			return append(std::make_move_iterator(records.begin()), std::make_move_iterator(records.end()));
+		}
+		else
+		{
+			auto count = static_cast<size_type>(std::distance(first, last));
+			if (count > m_capacity)
+			{
+				std::advance(first, count - m_capacity);
+				count = m_capacity;
+			}
+
+			if (not count) return;
+
+			auto size = live_size();
+			if (size + count > m_capacity)
+				evict(size + count - m_capacity);
+
+			reserve_store(count);
+			base_type::append(first, last);
+		}
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	template <class SinglePassIterator>
+	void ring_sequence_container<Type, Traits, SignalTraits>::assign(SinglePassIterator first, SinglePassIterator last)
+	{
+		using category = typename std::iterator_traits<SinglePassIterator>::iterator_category;
+		if constexpr (not std::is_base_of_v<std::forward_iterator_tag, category>)
+		{
+			std::vector<value_type> records(first, last);
+			return assign(std::make_move_iterator(records.begin()), std::make_move_iterator(records.end()));
+		}
+		else
+		{
+			auto count = static_cast<size_type>(std::distance(first, last));
+			if (count > m_capacity)
+			{
+				std::advance(first, count - m_capacity);
+				count = m_capacity;
+			}
+
+			// old records are kept in store until views are notified
+			reserve_store(count);
+			base_type::assign(first, last);
+		}
+	}
+}
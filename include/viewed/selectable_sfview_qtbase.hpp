@@ -1,7 +1,7 @@
 ﻿#pragma once
 #include <viewed/sfview_qtbase.hpp>
 #include <ext/algorithm/slide.hpp>
-#include <boost/container/flat_set.hpp>
+#include <unordered_set>
 
 namespace viewed
 {
@@ -19,7 +19,9 @@ namespace viewed
 	/// which will configure those predicates
 	/// 
 	/// it also provides an ability to select some elements(mark them as selected)
-	/// and then partition on those elements
+	/// and then partition on those elements.
+	/// When partitioned, view is two runs: selected and not selected records(order depends on m_partition_by_selection_asc),
+	/// each one sorted by sort_pred. Selection changes move records between runs via binary search, without repartitioning.
 	/// 
 	/// @Param Container - class to which this view will connect and listen updates, see view_base for more description
 	/// @Param SortPred - sort predicate or std::variant of predicates,
@@ -56,10 +58,13 @@ namespace viewed
 
 		using base_type::m_owner;
 		using base_type::m_store;
+		using base_type::m_sort_pred;
 		using base_type::get_model;
 
 	protected:
-		typedef boost::container::flat_set<view_pointer_type> selection_set_type;
+		/// hash set: O(1) is_selected on every paint and O(1) insert, bulk operations are linear.
+		/// Records have no stable numbering(hash containers), so selection is keyed by record pointer, not by slot bitmap
+		typedef std::unordered_set<view_pointer_type> selection_set_type;
 		selection_set_type m_selection_set;
 
 		bool m_partition_by_selection = false;
@@ -92,14 +97,24 @@ namespace viewed
 		/// emits qt beginResetModel/endResetModel
 		virtual void clear_selection();
 
+		/// bulk operations on rows of view, selection of records filtered out of view is kept as is.
+		/// each emits one notification: dataChanged for affected rows, or layoutChanged if partitioned by selection
+		virtual void select_all();
+		virtual void select_range(const_iterator first, const_iterator last, bool selected = true);
+		virtual void invert_selection();
+
 	protected:
-		/// rotates m_store so, that:
-		///   if {ext_it} was part of partition it moved just after partition
-		///   if {ext_it} was not part of partition it moved at the end of partition
+		/// record belongs to first run of view partitioned by selection
+		bool in_first_run(view_pointer_type ptr) const { return (m_selection_set.count(ptr) != 0) == m_partition_by_selection_asc; }
+		/// position in sorted run [first, last) where ptr should be inserted, after equal records.
+		/// if m_sort_pred is not active - last
+		auto run_insert_position(store_iterator first, store_iterator last, view_pointer_type ptr) const -> store_iterator;
+
+		/// moves {ext_it} from it's run into sorted position of other run, see run_insert_position.
+		/// Called before selection of {ext_it} is changed; other records are not moved, view stays two sorted runs.
 		/// this method must be called only when m_partition_by_selection == true
 		/// returns new position of element pointer by ext_it
 		virtual auto adjust_partition(iterator ext_it) -> iterator;
-		virtual auto adjust_partition(iterator first, iterator last) -> std::pair<iterator, iterator>;
 
 		virtual void erase_records(const signal_range_type & sorted_erased) override;
 		virtual void clear_view() override;
@@ -109,6 +124,13 @@ namespace viewed
 		                       int_vector_iterator ifirst, int_vector_iterator ilast);
 
 		virtual void partition_and_notify(store_iterator first, store_iterator last);
+		/// notifies about selection change of rows [first, last) made by bulk operation:
+		/// one dataChanged for those rows, or moves changed_rows(sorted) between runs if partitioned by selection
+		virtual void selection_changed_and_notify(int first, int last, const int_vector & changed_rows);
+		/// moves rows changed_rows(sorted), which selection is changed, to other run at sorted positions,
+		/// other rows keep their relative order. Persistent indexes are remapped once,
+		/// emits qt layoutAboutToBeChanged/layoutChanged
+		virtual void move_between_runs_and_notify(const int_vector & changed_rows);
 
 		/// merges m_store's [middle, last) into [first, last) according to m_sort_pred. stable.
 		/// first, middle, last - is are one range, as in std::inplace_merge
@@ -164,8 +186,8 @@ namespace viewed
 		}
 		else
 		{
-			auto sel_it = m_selection_set.lower_bound(ptr);
-			bool found = sel_it != m_selection_set.end() && *sel_it == ptr;
+			auto sel_it = m_selection_set.find(ptr);
+			bool found = sel_it != m_selection_set.end();
 
 			// selected | found    action
 			//    0     |   0      do nothing
@@ -176,7 +198,7 @@ namespace viewed
 			{
 				it = adjust_partition(it);
 				if (selected)
-					m_selection_set.insert(sel_it, ptr);
+					m_selection_set.insert(ptr);
 				else
 					m_selection_set.erase(sel_it);
 			}
@@ -216,56 +238,175 @@ namespace viewed
 	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::clear_selection()
 	{
 		// we clearing all selection, if we are partitioned by selection
-		// cleared elements must be rotated out of partitioned part,
-		// but because we are clearing - that part will become empty,
-		// so we can leave it as is
+		// selected run will become empty, both sorted runs are merged into one
 		
 		auto * model = get_model();
 		model->beginResetModel();
+
+		store_iterator pp;
+		if (m_partition_by_selection)
+			pp = std::partition_point(m_store.begin(), m_store.end(), [this](view_pointer_type ptr) { return in_first_run(ptr); });
+
 		m_selection_set.clear();
+		if (m_partition_by_selection)
+		{
+			base_type::merge_newdata(m_store.begin(), pp, m_store.end(), false);
+			this->invalidate_row_index();
+		}
+
 		model->endResetModel();
 	}
 
 	template <class Container, class SortPred, class FilterPred>
-	auto selectable_sfview_qtbase<Container, SortPred, FilterPred>::adjust_partition(iterator ext_it) -> iterator
+	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::select_all()
 	{
-		assert(m_partition_by_selection);
-		auto it = m_store.begin() + (ext_it.base() - m_store.begin()); // make iterator from const_iterator
-		decltype(it) pp;
+		select_range(this->begin(), this->end(), true);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::select_range(const_iterator first, const_iterator last, bool selected)
+	{
+		if (first == last) return;
+
+		int first_row = static_cast<int>(first.base() - m_store.begin());
+		int last_row = static_cast<int>(last.base() - m_store.begin());
+
+		int_vector changed_rows;
+		if (selected) m_selection_set.reserve(m_selection_set.size() + (last_row - first_row));
 
-		if (m_partition_by_selection_asc) {
-			auto pred = [this](auto ptr) { return m_selection_set.count(ptr) != 0; };
-			pp = std::partition_point(m_store.begin(), m_store.end(), pred);
+		for (int row = first_row; row < last_row; ++row)
+		{
+			bool changed = selected ? m_selection_set.insert(m_store[row]).second
+			                        : m_selection_set.erase(m_store[row]) != 0;
+			if (changed) changed_rows.push_back(row);
 		}
-		else {
-			auto pred = [this](auto ptr) { return m_selection_set.count(ptr) == 0; };
-			pp = std::partition_point(m_store.begin(), m_store.end(), pred);
+
+		selection_changed_and_notify(first_row, last_row, changed_rows);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::invert_selection()
+	{
+		int_vector changed_rows(m_store.size());
+		std::iota(changed_rows.begin(), changed_rows.end(), 0);
+
+		for (auto ptr : m_store)
+		{
+			auto it = m_selection_set.find(ptr);
+			if (it == m_selection_set.end())
+				m_selection_set.insert(ptr);
+			else
+				m_selection_set.erase(it);
 		}
 
-		return ext::slide(it, it + 1, pp).first;
+		selection_changed_and_notify(0, static_cast<int>(m_store.size()), changed_rows);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
-	auto selectable_sfview_qtbase<Container, SortPred, FilterPred>::adjust_partition(iterator first, iterator last) -> std::pair<iterator, iterator>
+	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::
+		selection_changed_and_notify(int first, int last, const int_vector & changed_rows)
+	{
+		if (changed_rows.empty()) return;
+		if (m_partition_by_selection)
+			return move_between_runs_and_notify(changed_rows);
+
+		auto * model = get_model();
+		auto ncol = model->columnCount(model->invalid_index);
+		auto topLeft = model->index(first, 0, model->invalid_index);
+		auto bottomRight = model->index(last - 1, ncol - 1, model->invalid_index);
+		Q_EMIT model->dataChanged(topLeft, bottomRight, model->all_roles);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::move_between_runs_and_notify(const int_vector & changed_rows)
 	{
 		assert(m_partition_by_selection);
-		// make iterator from const_iterator
-		auto ifirst = m_store.begin() + (first.base() - m_store.begin());
-		auto ilast = m_store.begin() + (last.base() - m_store.begin());
-		decltype(ifirst) pp;
+		assert(std::is_sorted(changed_rows.begin(), changed_rows.end()));
+
+		auto is_changed = [&changed_rows](int row) { return std::binary_search(changed_rows.begin(), changed_rows.end(), row); };
+		// selection of changed rows is already updated: they were in first run if they are not now
+		auto was_in_first = [&](int row) { return in_first_run(m_store[row]) != is_changed(row); };
 
-		if (m_partition_by_selection_asc)
+		int size = static_cast<int>(m_store.size());
+		int pp = 0;
+		for (int count = size; count > 0;)
 		{
-			auto pred = [this](auto ptr) { return m_selection_set.count(ptr) != 0; };
-			pp = std::partition_point(m_store.begin(), m_store.end(), pred);
+			int step = count / 2;
+			if (was_in_first(pp + step)) pp += step + 1, count -= step + 1;
+			else                         count = step;
 		}
-		else
+
+		auto * model = get_model();
+		Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->VerticalSortHint);
+
+		// runs without changed rows stay sorted, changed rows of each run are sorted too:
+		// each changed row is inserted into other run at binary searched position
+		store_type store;
+		int_vector rows; // new row -> old row
+		store.reserve(size);
+		rows.reserve(size);
+
+		store_type kept;
+		int_vector kept_rows;
+		auto merge_run = [&](int run_first, int run_last, auto moved_first, auto moved_last)
 		{
-			auto pred = [this](auto ptr) { return m_selection_set.count(ptr) == 0; };
-			pp = std::partition_point(m_store.begin(), m_store.end(), pred);
-		}
+			kept.clear();
+			kept_rows.clear();
+			for (int row = run_first; row < run_last; ++row)
+				if (not is_changed(row)) kept.push_back(m_store[row]), kept_rows.push_back(row);
+
+			auto pos = kept.begin();
+			for (; moved_first != moved_last; ++moved_first)
+			{
+				int row = *moved_first;
+				auto next = run_insert_position(pos, kept.end(), m_store[row]);
+
+				store.insert(store.end(), pos, next);
+				rows.insert(rows.end(), kept_rows.begin() + (pos - kept.begin()), kept_rows.begin() + (next - kept.begin()));
+				store.push_back(m_store[row]);
+				rows.push_back(row);
+				pos = next;
+			}
+
+			store.insert(store.end(), pos, kept.end());
+			rows.insert(rows.end(), kept_rows.begin() + (pos - kept.begin()), kept_rows.end());
+		};
+
+		auto moved_pp = std::partition_point(changed_rows.begin(), changed_rows.end(), [pp](int row) { return row < pp; });
+		merge_run(0, pp, moved_pp, changed_rows.end());      // moved from second run to first
+		merge_run(pp, size, changed_rows.begin(), moved_pp); // moved from first run to second
 
-		return ext::slide(ifirst, ilast, pp);
+		m_store = std::move(store);
+		viewed::inverse_index_array(rows.begin(), rows.end());
+		this->change_indexes(rows.begin(), rows.end(), 0);
+
+		Q_EMIT model->layoutChanged(model_type::empty_model_list, model->VerticalSortHint);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	auto selectable_sfview_qtbase<Container, SortPred, FilterPred>::
+		run_insert_position(store_iterator first, store_iterator last, view_pointer_type ptr) const -> store_iterator
+	{
+		if (not active(m_sort_pred)) return last;
+
+		auto comp = viewed::make_indirect_fun(m_sort_pred);
+		return varalgo::upper_bound(first, last, ptr, comp);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	auto selectable_sfview_qtbase<Container, SortPred, FilterPred>::adjust_partition(iterator ext_it) -> iterator
+	{
+		assert(m_partition_by_selection);
+		auto it = m_store.begin() + (ext_it.base() - m_store.begin()); // make iterator from const_iterator
+		auto pred = [this](auto ptr) { return in_first_run(ptr); };
+		auto pp = std::partition_point(m_store.begin(), m_store.end(), pred);
+
+		// moved into sorted position of other run
+		auto pos = it < pp ? run_insert_position(pp, m_store.end(), *it)
+		                   : run_insert_position(m_store.begin(), pp, *it);
+
+		this->invalidate_row_index();
+		return iterator(ext::slide(it, it + 1, pos).first);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
@@ -288,16 +429,8 @@ namespace viewed
 	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::
 		partition(store_iterator first, store_iterator last)
 	{
-		if (m_partition_by_selection_asc)
-		{
-			auto pred = [this](view_pointer_type ptr) { return m_selection_set.count(ptr) != 0; };
-			std::stable_partition(first, last, pred);
-		}
-		else
-		{
-			auto pred = [this](view_pointer_type ptr) { return m_selection_set.count(ptr) == 0; };
-			std::stable_partition(first, last, pred);
-		}
+		auto pred = [this](view_pointer_type ptr) { return in_first_run(ptr); };
+		std::stable_partition(first, last, pred);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
@@ -308,16 +441,8 @@ namespace viewed
 		auto zfirst = ext::make_zip_iterator(first, ifirst);
 		auto zlast = ext::make_zip_iterator(last, ilast);
 
-		if (m_partition_by_selection_asc)
-		{
-			auto pred = [this](view_pointer_type ptr) { return m_selection_set.count(ptr) != 0; };
-			std::stable_partition(zfirst, zlast, viewed::make_get_functor<0>(pred));
-		}
-		else
-		{
-			auto pred = [this](view_pointer_type ptr) { return m_selection_set.count(ptr) == 0; };
-			std::stable_partition(zfirst, zlast, viewed::make_get_functor<0>(pred));
-		}
+		auto pred = [this](view_pointer_type ptr) { return in_first_run(ptr); };
+		std::stable_partition(zfirst, zlast, viewed::make_get_functor<0>(pred));
 	}
 
 	template <class Container, class SortPred, class FilterPred>
@@ -333,10 +458,12 @@ namespace viewed
 		auto ilast = indexes.end();
 		std::iota(ifirst, ilast, offset);
 
-		partition(first, last, ifirst, ilast);
+		// partitioned view also sorts both runs
+		if (m_partition_by_selection) stable_sort(first, last, ifirst, ilast);
+		else                          partition(first, last, ifirst, ilast);
 
 		viewed::inverse_index_array(ifirst, ilast, offset);
-		change_indexes(ifirst, ilast, offset);
+		this->change_indexes(ifirst, ilast, offset);
 
 		Q_EMIT model->layoutChanged(model_type::empty_model_list, model->VerticalSortHint);
 	}
@@ -345,10 +472,18 @@ namespace viewed
 	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::
 		merge_newdata(store_iterator first, store_iterator middle, store_iterator last, bool resort_old)
 	{
-		if (m_partition_by_selection)
-			return partition(first, last);
-		else
+		if (not m_partition_by_selection)
 			return base_type::merge_newdata(first, middle, last, resort_old);
+
+		// [first, middle) is already partitioned: partition new records and merge each run separately
+		auto pred = [this](view_pointer_type ptr) { return in_first_run(ptr); };
+		auto old_pp = std::partition_point(first, middle, pred);
+		auto new_pp = std::stable_partition(middle, last, pred);
+
+		// old first, new first, old second, new second
+		auto pp = std::rotate(old_pp, middle, new_pp);
+		base_type::merge_newdata(first, old_pp, pp, resort_old);
+		base_type::merge_newdata(pp, pp + (middle - old_pp), last, resort_old);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
@@ -357,29 +492,53 @@ namespace viewed
 		              int_vector_iterator ifirst, int_vector_iterator imiddle, int_vector_iterator ilast,
 		              bool resort_old)
 	{
-		if (m_partition_by_selection)
-			return partition(first, last, ifirst, ilast);
-		else
+		if (not m_partition_by_selection)
 			return base_type::merge_newdata(first, middle, last, ifirst, imiddle, ilast, resort_old);
+
+		// same as above, index range is permuted along
+		auto pred = [this](view_pointer_type ptr) { return in_first_run(ptr); };
+		auto old_pp = std::partition_point(first, middle, pred);
+
+		auto zmiddle = ext::make_zip_iterator(middle, imiddle);
+		auto zlast = ext::make_zip_iterator(last, ilast);
+		auto new_pp = middle + (std::stable_partition(zmiddle, zlast, viewed::make_get_functor<0>(pred)) - zmiddle);
+
+		auto iold_pp = ifirst + (old_pp - first);
+		auto inew_pp = ifirst + (new_pp - first);
+		std::rotate(iold_pp, imiddle, inew_pp);
+		auto pp = std::rotate(old_pp, middle, new_pp);
+		auto ipp = ifirst + (pp - first);
+
+		auto second_middle = pp + (middle - old_pp);
+		auto isecond_middle = ifirst + (second_middle - first);
+		base_type::merge_newdata(first, old_pp, pp, ifirst, iold_pp, ipp, resort_old);
+		base_type::merge_newdata(pp, second_middle, last, ipp, isecond_middle, ilast, resort_old);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
 	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::stable_sort(store_iterator first, store_iterator last)
 	{
-		if (m_partition_by_selection)
-			return partition(first, last);
-		else
+		if (not m_partition_by_selection)
 			return base_type::stable_sort(first, last);
+
+		partition(first, last);
+		auto pp = std::partition_point(first, last, [this](view_pointer_type ptr) { return in_first_run(ptr); });
+		base_type::stable_sort(first, pp);
+		base_type::stable_sort(pp, last);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
 	void selectable_sfview_qtbase<Container, SortPred, FilterPred>::
 		stable_sort(store_iterator first, store_iterator last, int_vector_iterator ifirst, int_vector_iterator ilast)
 	{
-		if (m_partition_by_selection)
-			return partition(first, last, ifirst, ilast);
-		else
+		if (not m_partition_by_selection)
 			return base_type::stable_sort(first, last, ifirst, ilast);
+
+		partition(first, last, ifirst, ilast);
+		auto pp = std::partition_point(first, last, [this](view_pointer_type ptr) { return in_first_run(ptr); });
+		auto ipp = ifirst + (pp - first);
+		base_type::stable_sort(first, pp, ifirst, ipp);
+		base_type::stable_sort(pp, last, ipp, ilast);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
@@ -391,29 +550,18 @@ namespace viewed
 		auto begIt = m_store.begin();
 		auto endIt = m_store.end();
 		
-		bool asc = m_partition_by_selection_asc;
-		decltype(begIt) pp;
-		if (asc)
-		{
-			auto pred = [this](view_pointer_type ptr) { return m_selection_set.count(ptr) != 0; };
-			pp = std::partition_point(begIt, endIt, pred);
-		}
-		else
-		{
-			auto pred = [this](view_pointer_type ptr) { return m_selection_set.count(ptr) == 0; };
-			pp = std::partition_point(begIt, endIt, pred);
-		}
+		auto pred = [this](view_pointer_type ptr) { return in_first_run(ptr); };
+		auto pp = std::partition_point(begIt, endIt, pred);
 
-		// asc | sel -> action
-		//  0     0  -> search [begIt; pp)
-		//  0     1  -> search [pp; endIt)
-		//  1     0  -> search [pp; endIt)
-		//  1     1  -> search [begIt; pp)
-		if ((m_selection_set.count(ptr) != 0) ^ asc)
-			begIt = pp;
-		else
+		if (in_first_run(ptr))
 			endIt = pp;
+		else
+			begIt = pp;
+
+		// runs are sorted
+		if (not active(m_sort_pred)) return {begIt, endIt};
 
-		return {begIt, endIt};
+		auto comp = viewed::make_indirect_fun(m_sort_pred);
+		return varalgo::equal_range(begIt, endIt, ptr, comp);
 	}
 }
@@ -1,9 +1,15 @@
 #pragma once
+#include <cassert>
+#include <memory>
+#include <utility>  // for exchange
 #include <algorithm>
 #include <iterator> // for back_inserter
 #include <boost/iterator/iterator_adaptor.hpp>
 
 #include <viewed/signal_traits.hpp>
+#include <viewed/algorithm.hpp>
+#include <viewed/container_snapshot.hpp>
+#include <viewed/chunked_storage.hpp>
 #include <ext/try_reserve.hpp>
 
 namespace viewed
@@ -67,6 +73,30 @@ namespace viewed
 		static auto value_pointer(      internal_value_type & val) { return val.get(); }
 	};
 
+	/// sequence_container traits with elements stored densely in fixed size chunks, see chunked_storage.
+	/// Pointers are stable, bulk append allocates once per ChunkSize elements instead of once per element.
+	/// Traits hold storage object, so make_internal is not static
+	template <class Type, std::size_t ChunkSize = 256>
+	struct chunked_sequence_container_traits
+	{
+		using storage_type        = chunked_storage<Type, ChunkSize>;
+		using internal_value_type = typename storage_type::handle;
+		using main_store_type     = std::vector<internal_value_type>;
+		using signal_store_type   = std::vector<const Type *>;
+
+		storage_type storage;
+
+		static main_store_type make_store()           { return {}; }
+		auto make_internal(Type && val)               { return storage.make(std::move(val)); }
+		auto make_internal(const Type & val)          { return storage.make(val); }
+
+		static decltype(auto) value_reference(const internal_value_type & val) { return (*val); }
+		static decltype(auto) value_reference(      internal_value_type & val) { return (*val); }
+
+		static auto value_pointer(const internal_value_type & val) { return val.get(); }
+		static auto value_pointer(      internal_value_type & val) { return val.get(); }
+	};
+
 	/*
 	/// signal_traits describes types used for communication between stores and views
 	/// see also default_signal_traits for an example
@@ -199,6 +229,13 @@ namespace viewed
 		static view_pointer_type get_view_pointer(const_reference ref)     noexcept { return &ref; }
 		static const_reference   get_view_reference(view_pointer_type ptr) noexcept { return *ptr; }
 
+	public:
+		class batch_scope;
+
+		/// immutable copy of container records, see snapshot
+		typedef container_snapshot<value_type>           snapshot_type;
+		typedef std::shared_ptr<const snapshot_type>     snapshot_pointer;
+
 	protected:
 		main_store_type m_store;
 
@@ -206,6 +243,14 @@ namespace viewed
 		erase_signal_type  m_erase_signal;
 		clear_signal_type  m_clear_signal;
 
+		/// batch state, see begin_batch.
+		/// pending erased records are sorted by pointer value and unique
+		unsigned m_batch_depth = 0;
+		signal_store_type m_batch_erased, m_batch_updated, m_batch_inserted;
+
+		/// tracks changes for snapshot, created on first snapshot call
+		std::unique_ptr<snapshot_tracker<value_type>> m_snapshot_tracker;
+
 	public:
 		      iterator begin()        noexcept { return iterator(m_store.begin()); }
 		      iterator end()          noexcept { return iterator(m_store.end()); }
@@ -216,10 +261,10 @@ namespace viewed
 
 		      reverse_iterator rbegin()        noexcept { return reverse_iterator(m_store.rbegin()); }
 		      reverse_iterator rend()          noexcept { return reverse_iterator(m_store.rend()); }
-		const_reverse_iterator rbegin()  const noexcept { return const_reverse_iterator(m_store.crbegin()); }
-		const_reverse_iterator rend()    const noexcept { return const_reverse_iterator(m_store.crend()); }
-		const_reverse_iterator crbegin() const noexcept { return const_reverse_iterator(m_store.crbegin()); }
-		const_reverse_iterator crend()   const noexcept { return const_reverse_iterator(m_store.crend()); }
+		const_reverse_iterator rbegin()  const noexcept { return const_reverse_iterator(m_store.rbegin()); }
+		const_reverse_iterator rend()    const noexcept { return const_reverse_iterator(m_store.rend()); }
+		const_reverse_iterator crbegin() const noexcept { return const_reverse_iterator(m_store.rbegin()); }
+		const_reverse_iterator crend()   const noexcept { return const_reverse_iterator(m_store.rend()); }
 
 		size_type size() const noexcept { return m_store.size(); }
 		bool empty()     const noexcept { return m_store.empty(); }
@@ -256,8 +301,30 @@ namespace viewed
 		/// notifies views about update
 		void notify_views(signal_store_type & erased, signal_store_type & updated, signal_store_type & inserted);
 
+		/// appends records into pending batch stores, views are notified about them in end_batch
+		void gather_batch(signal_store_type & erased, signal_store_type & updated, signal_store_type & inserted);
+		/// ends batch started by begin_batch, if it's outermost one - notifies views with merged ranges
+		/// and removes erased records from internal store
+		void end_batch();
+
+	public:
+		/// starts batch update, which lasts while returned scope object is alive.
+		/// While batch is active append/assign/erase do not emit signals, instead erased/inserted records are gathered
+		/// and views are notified once, with merged ranges, when outermost batch ends.
+		/// Erased records are kept in container until batch ends. Batches can be nested.
+		batch_scope begin_batch() { ++m_batch_depth; return batch_scope(this); }
+		/// returns true if there is an active batch
+		bool in_batch() const noexcept { return m_batch_depth != 0; }
+
+		/// returns immutable reference counted copy of current records, which can be iterated from any thread.
+		/// First call starts tracking container changes, following calls copy only changed parts of previous snapshot.
+		/// Inside active batch last snapshot is returned, changes are seen after batch ends.
+		/// Only if snapshot must be rebuilt(first call, after clear or mass erase) it is built from current records: without records inserted by batch,
+		/// with records erased by it, but with in place updates done by batch - old values are not kept.
+		snapshot_pointer snapshot();
+
 	public:
-		/// erases all elements
+		/// erases all elements, pending batch records are discarded
 		void clear();
 		/// erases elements [first, last) from internal store and views
 		/// [first, last) must be a valid range
@@ -294,6 +361,29 @@ namespace viewed
 		sequence_container & operator =(sequence_container && op) = default;
 	};
 
+	/// RAII batch scope, see sequence_container::begin_batch.
+	/// Ends batch on destruction or on explicit commit call
+	template <class Type, class Traits, class SignalTraits>
+	class sequence_container<Type, Traits, SignalTraits>::batch_scope
+	{
+		sequence_container * m_owner = nullptr;
+
+	public:
+		/// ends batch before scope object is destroyed
+		void commit() { if (m_owner) std::exchange(m_owner, nullptr)->end_batch(); }
+
+	public:
+		batch_scope() = default;
+		explicit batch_scope(sequence_container * owner) noexcept : m_owner(owner) {}
+		~batch_scope() { commit(); }
+
+		batch_scope(batch_scope && op) noexcept : m_owner(std::exchange(op.m_owner, nullptr)) {}
+		batch_scope & operator =(batch_scope && op) { if (this != &op) { commit(); m_owner = std::exchange(op.m_owner, nullptr); } return *this; }
+
+		batch_scope(const batch_scope &) = delete;
+		batch_scope & operator =(const batch_scope &) = delete;
+	};
+
 
 
 	template <class Type, class Traits, class SignalTraits>
@@ -310,6 +400,7 @@ namespace viewed
 			inserted.push_back(get_pointer(m_store.back()));
 		}
 
+		if (m_batch_depth) return gather_batch(erased, updated, inserted);
 		notify_views(erased, updated, inserted);
 	}
 
@@ -333,6 +424,9 @@ namespace viewed
 			inserted.push_back(get_pointer(m_store.back()));
 		}
 
+		// old records are removed from the store when batch ends
+		if (m_batch_depth) return gather_batch(erased, updated, inserted);
+
 		notify_views(erased, updated, inserted);
 		m_store.erase(m_store.begin(), m_store.begin() + erased.size());
 	}
@@ -341,16 +435,22 @@ namespace viewed
 	void sequence_container<Type, Traits, SignalTraits>::erase_from_views(const_iterator first, const_iterator last)
 	{
 		signal_store_type todel;
-		std::transform(first, last, std::back_inserter(todel), get_pointer);
+		std::transform(first, last, std::back_inserter(todel), get_view_pointer);
 
 		auto rawRange = signal_traits::make_range(todel.data(), todel.data() + todel.size());
 		m_erase_signal(rawRange);
+		if (m_snapshot_tracker) m_snapshot_tracker->on_erase(rawRange);
 	}
 
 	template <class Type, class Traits, class SignalTraits>
 	void sequence_container<Type, Traits, SignalTraits>::clear()
 	{
 		m_clear_signal();
+		if (m_snapshot_tracker) m_snapshot_tracker->on_clear();
+
+		m_batch_erased.clear();
+		m_batch_updated.clear();
+		m_batch_inserted.clear();
 		m_store.clear();
 	}
 
@@ -362,14 +462,86 @@ namespace viewed
 		auto irr = signal_traits::make_range(inserted.data(), inserted.data() + inserted.size());
 		auto err = signal_traits::make_range(erased.data(), erased.data() + erased.size());
 		m_update_signal(err, urr, irr);
+		if (m_snapshot_tracker) m_snapshot_tracker->on_update(err, urr, irr);
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	void sequence_container<Type, Traits, SignalTraits>::gather_batch
+		(signal_store_type & erased, signal_store_type & updated, signal_store_type & inserted)
+	{
+		m_batch_updated.insert(m_batch_updated.end(), updated.begin(), updated.end());
+		m_batch_inserted.insert(m_batch_inserted.end(), inserted.begin(), inserted.end());
+		if (erased.empty()) return;
+
+		// keep pending erased sorted and unique, end_batch uses binary search on them
+		auto middle = m_batch_erased.insert(m_batch_erased.end(), erased.begin(), erased.end());
+		std::sort(middle, m_batch_erased.end());
+		std::inplace_merge(m_batch_erased.begin(), middle, m_batch_erased.end());
+		m_batch_erased.erase(std::unique(m_batch_erased.begin(), m_batch_erased.end()), m_batch_erased.end());
+	}
+
+	template <class Type, class Traits, class SignalTraits>
+	void sequence_container<Type, Traits, SignalTraits>::end_batch()
+	{
+		assert(m_batch_depth);
+		if (--m_batch_depth) return;
+
+		signal_store_type erased, updated, inserted, signal_erased;
+		erased.swap(m_batch_erased);
+		updated.swap(m_batch_updated);
+		inserted.swap(m_batch_inserted);
+
+		if (erased.empty() and updated.empty() and inserted.empty())
+			return;
+
+		auto erased_first = erased.begin();
+		auto erased_last  = erased.end();
+
+		// append followed by erase -> views never saw those records, they are only removed from the store.
+		// Mark them in both lists, marking keeps erased sorted - pointers are at least 2 byte aligned
+		for (auto & ptr : inserted)
+		{
+			auto it = std::lower_bound(erased_first, erased_last, ptr);
+			if (it != erased_last and *it == ptr) *it = ptr = viewed::mark_pointer(ptr);
+		}
+
+		inserted.erase(std::remove_if(inserted.begin(), inserted.end(), viewed::marked_pointer), inserted.end());
+		std::remove_copy_if(erased_first, erased_last, std::back_inserter(signal_erased), viewed::marked_pointer);
+		std::transform(erased_first, erased_last, erased_first, viewed::unmark_pointer);
+
+		notify_views(signal_erased, updated, inserted);
+
+		auto is_erased = [erased_first, erased_last](auto & val) { return std::binary_search(erased_first, erased_last, get_pointer(val)); };
+		m_store.erase(std::remove_if(m_store.begin(), m_store.end(), is_erased), m_store.end());
 	}
 
 
+	template <class Type, class Traits, class SignalTraits>
+	auto sequence_container<Type, Traits, SignalTraits>::snapshot() -> snapshot_pointer
+	{
+		if (not m_snapshot_tracker)
+			m_snapshot_tracker = std::make_unique<snapshot_tracker<value_type>>();
+
+		if (m_batch_depth)
+			return m_snapshot_tracker->batch_snapshot(begin(), end(), m_batch_inserted);
+
+		return m_snapshot_tracker->snapshot(begin(), end());
+	}
+
 	template <class Type, class Traits, class SignalTraits>
 	auto sequence_container<Type, Traits, SignalTraits>::erase(const_iterator first, const_iterator last) -> const_iterator
 	{
+		if (m_batch_depth)
+		{
+			// records are erased from store when batch ends
+			signal_store_type erased, none;
+			std::transform(first, last, std::back_inserter(erased), get_view_pointer);
+			gather_batch(erased, none, none);
+			return last;
+		}
+
 		erase_from_views(first, last);
-		return m_store.erase(first, last);
+		return const_iterator(m_store.erase(first.base(), last.base()));
 	}
 
 	template <class Type, class Traits, class SignalTraits>
@@ -377,6 +377,9 @@ namespace viewed
 		sort_pred_type m_sort_pred;
 		filter_pred_type m_filter_pred;
 
+		/// persistent index changes gathered by change_indexes, see apply_index_remap
+		persistent_index_remap m_index_remap;
+
 	protected:
 		template <class Functor>
 		static void for_each_child_page(page_type & page, Functor && func);
@@ -410,11 +413,13 @@ namespace viewed
 		/// emits qt signal this->dataChanged about changed rows. Changred rows are defined by [first; last)
 		/// default implantation just calls this->dataChanged(index(row, 0, parent), index(row, this->columnCount, parent))
 		virtual void emit_changed(QModelIndex parent, int_vector::const_iterator first, int_vector::const_iterator last);
-		/// changes persistent indexes via this->changePersistentIndex.
+		/// gathers persistent indexes changes of page into m_index_remap, those are applied by apply_index_remap.
 		/// [first; last) - range where range[oldIdx - offset] => newIdx.
 		/// if newIdx < 0 - index should be removed(changed on invalid, qt supports it)
 		virtual void change_indexes(page_type & page, QModelIndexList::const_iterator model_index_first, QModelIndexList::const_iterator model_index_last,
 		                            int_vector::const_iterator first, int_vector::const_iterator last, int offset);
+		/// applies persistent index changes gathered by change_indexes for all pages with one this->changePersistentIndexList call
+		void apply_index_remap();
 		/// inverses index array in following way:
 		/// inverse[arr[i] - offset] = i for first..last.
 		/// This is for when you have array of arr[new_index] => old_index,
@@ -689,11 +694,23 @@ namespace viewed
 			if (row < offset) continue;
 
 			assert(row < size); (void)size;
-			auto newIdx = create_index(first[row - offset], col, pageptr);
-			this->changePersistentIndex(idx, newIdx);
+			int new_row = first[row - offset];
+			if (new_row == row) continue;
+
+			auto newIdx = new_row < 0 ? model_helper::invalid_index : create_index(new_row, col, pageptr);
+			m_index_remap.add(idx, newIdx);
 		}
 	}
 
+	template <class Traits, class ModelBase>
+	void sftree_facade_qtbase<Traits, ModelBase>::apply_index_remap()
+	{
+		if (m_index_remap.empty()) return;
+
+		this->changePersistentIndexList(m_index_remap.from(), m_index_remap.to());
+		m_index_remap.clear();
+	}
+
 	template <class Traits, class ModelBase>
 	void sftree_facade_qtbase<Traits, ModelBase>::inverse_index_array(int_vector & inverse, int_vector::iterator first, int_vector::iterator last, int offset)
 	{
@@ -793,6 +810,7 @@ namespace viewed
 
 		sort_and_notify(m_root, ctx);
 
+		apply_index_remap();
 		this->layoutChanged(model_helper::empty_model_list, model_helper::NoLayoutChangeHint);
 	}
 
@@ -862,6 +880,7 @@ namespace viewed
 
 		refilter_incremental_and_notify(m_root, ctx);
 
+		apply_index_remap();
 		this->layoutChanged(model_helper::empty_model_list, model_helper::NoLayoutChangeHint);
 	}
 
@@ -935,6 +954,7 @@ namespace viewed
 
 		refilter_full_and_notify(m_root, ctx);
 
+		apply_index_remap();
 		this->layoutChanged(model_helper::empty_model_list, model_helper::NoLayoutChangeHint);
 	}
 	
@@ -1604,6 +1624,7 @@ namespace viewed
 
 		this->update_page_and_notify(m_root, ctx);
 
+		apply_index_remap();
 		this->layoutChanged(model_helper::empty_model_list, model_helper::NoLayoutChangeHint);
 	}
 }
@@ -1,5 +1,7 @@
 ﻿#pragma once
 #include <vector>
+#include <chrono>
+#include <optional>
 #include <algorithm>
 
 #include <viewed/forward_types.hpp>
@@ -7,6 +9,11 @@
 #include <viewed/get_functor.hpp>
 #include <viewed/indirect_functor.hpp>
 #include <viewed/view_qtbase.hpp>
+#include <viewed/parallel_sort.hpp>
+#include <viewed/parallel_filter.hpp>
+#include <viewed/sort_key_projection.hpp>
+
+#include <QtCore/QTimer>
 
 #include <boost/range/algorithm.hpp>
 #include <boost/range/algorithm_ext.hpp>
@@ -30,6 +37,13 @@ namespace viewed
 	///   sort_pred - predicate can sort items, otherwise it can not and whole view will be unsorted.
 	///   filter_pred - predicate can filter items, otherwise it is assumed all items are always passes filter(empty filter)
 	/// 
+	/// sort predicate can, optionally, provide fields() -> field_mask_type method: record fields it depends on.
+	/// If container reports changed fields(see view_base::updated_fields) and updated records have none of them changed -
+	/// view is not resorted.
+	/// 
+	/// sort predicate can, optionally, provide key(const value_type &) projection(see sort_key_projection.hpp):
+	/// than keys are projected once per sort/merge and sorted instead of records, arithmetic keys - with radix sort.
+	/// 
 	/// In derived class you can provide methods like sort_by/filter_by,
 	/// which will configure those predicates
 	/// 
@@ -51,6 +65,7 @@ namespace viewed
 	public:
 		using typename base_type::container_type;
 		using typename base_type::view_pointer_type;
+		using typename base_type::value_type;
 
 		typedef SortPred sort_pred_type;
 		typedef FilterPred filter_pred_type;
@@ -62,6 +77,7 @@ namespace viewed
 		using typename base_type::signal_range_type;
 		using typename base_type::model_type;
 		using typename base_type::int_vector;
+		using typename base_type::field_mask_vector;
 		using int_vector_iterator = typename int_vector::iterator;
 
 		using signal_const_iterator = typename signal_range_type::const_iterator;
@@ -72,6 +88,9 @@ namespace viewed
 		using base_type::get_view_pointer;
 		using base_type::change_indexes;
 		using base_type::emit_changed;
+		using base_type::lookup_row;
+		using base_type::invalidate_row_index;
+		using base_type::notify_row_changes;
 
 
 		typedef typename store_type::iterator       store_iterator;
@@ -86,10 +105,91 @@ namespace viewed
 		sort_pred_type m_sort_pred;
 		filter_pred_type m_filter_pred;
 
+		/// ranges of at least m_parallel_sort_threshold records are sorted in parallel, 0 - disabled
+		std::size_t m_parallel_sort_threshold = 0;
+		parallel_sort_pool * m_sort_pool = nullptr;
+
+		/// owner ranges of at least m_parallel_filter_threshold records are filtered in parallel, 0 - disabled
+		std::size_t m_parallel_filter_threshold = 0;
+		parallel_sort_pool * m_filter_pool = nullptr;
+		/// filter results parallel to updated range of currently processed update_store, precomputed in parallel.
+		/// Empty - filter is evaluated by update_store itself
+		std::vector<char> m_updated_passes;
+
+		/// asynchronous refilter state, see filter_by_async.
+		/// m_async_rtype - pending refilter type, same - nothing pending.
+		/// m_async_records - records being refiltered: for full refilter sorted by pointer, for incremental - m_store copy,
+		/// m_async_passes - filter results of m_async_records[0, m_async_passes.size())
+		refilter_type m_async_rtype = refilter_type::same;
+		store_type m_async_records;
+		std::vector<char> m_async_passes;
+		std::chrono::steady_clock::duration m_refilter_slice_budget = std::chrono::milliseconds(8);
+		bool m_refilter_scheduled = false;
+
+		/// earlier filter result: filter state, records passed it(in view order at capture time),
+		/// and records changed since capture: pointer + alive flag(false - erased), in order of changes
+		struct filter_history_entry
+		{
+			filter_pred_type filter;
+			store_type records;
+			std::vector<std::pair<view_pointer_type, bool>> changes;
+		};
+
+		/// bounded stack of earlier filter results, most recent last, see set_filter_history_depth
+		std::vector<filter_history_entry> m_filter_history;
+		std::size_t m_filter_history_depth = 0;
+
 	public:
 		/// reinitializes view from owner
 		virtual void reinit_view() override;
 
+		/// enables parallel sorting/merging(parallel_stable_sort, parallel_inplace_merge) on pool
+		/// for ranges of threshold or more records, null pool - default_parallel_sort_pool.
+		/// Stability and permutations passed to change_indexes are same as with sequential algorithms.
+		/// 0 - disabled, default
+		void set_parallel_sort_threshold(std::size_t threshold, parallel_sort_pool * pool = nullptr) noexcept
+		{
+			m_parallel_sort_threshold = threshold;
+			m_sort_pool = pool;
+		}
+
+		std::size_t parallel_sort_threshold() const noexcept { return m_parallel_sort_threshold; }
+
+		/// enables parallel filter evaluation in reinit_view and refilter_full_and_notify on pool
+		/// for owners with threshold or more records, null pool - default_parallel_sort_pool.
+		/// Filter predicate must be safe to call concurrently. Results and qt signals are same as with sequential evaluation.
+		/// 0 - disabled, default
+		void set_parallel_filter_threshold(std::size_t threshold, parallel_sort_pool * pool = nullptr) noexcept
+		{
+			m_parallel_filter_threshold = threshold;
+			m_filter_pool = pool;
+		}
+
+		std::size_t parallel_filter_threshold() const noexcept { return m_parallel_filter_threshold; }
+
+		/// time budget of one asynchronous refilter slice, see filter_by_async
+		void set_refilter_slice_budget(std::chrono::steady_clock::duration budget) noexcept { m_refilter_slice_budget = budget; }
+		auto refilter_slice_budget() const noexcept { return m_refilter_slice_budget; }
+
+		/// true if asynchronous refilter is in progress, see filter_by_async
+		bool refilter_pending() const noexcept { return m_async_rtype != refilter_type::same; }
+		/// asynchronous refilter progress: number of evaluated records and total number of records to evaluate
+		auto refilter_progress() const noexcept -> std::pair<std::size_t, std::size_t> { return {m_async_passes.size(), m_async_records.size()}; }
+
+		/// evaluates filter for next records of asynchronous refilter until slice budget is elapsed,
+		/// when all records are evaluated - publishes result. Returns true if refilter is still pending.
+		/// Normally called by scheduled slices, see schedule_refilter_slice
+		bool process_refilter_slice();
+		/// finishes pending asynchronous refilter synchronously
+		void finish_refilter();
+
+		/// keeps results of up to depth earlier filter states. When filter changes to one of them(like backspacing to previous prefix),
+		/// full refilter restores remembered result, evaluating filter only for records changed since then.
+		/// Filter predicate must provide operator == recognizing same filter state, otherwise history is never used.
+		/// 0 - disabled, default
+		void set_filter_history_depth(std::size_t depth);
+		std::size_t filter_history_depth() const noexcept { return m_filter_history_depth; }
+
 	protected:
 		/// adjusts view with erased/updated/inserted data, preserving filter/sort order. stable
 		/// emits appropriate qt signals, uses merge_newdata(iter..., iter..., ...) to calculate index permutations.
@@ -97,6 +197,11 @@ namespace viewed
 			const signal_range_type & sorted_erased,
 			const signal_range_type & sorted_updated,
 			const signal_range_type & inserted) override;
+
+		/// erases records, also notifies predicates caching per record data, see invalidate_predicate
+		virtual void erase_records(const signal_range_type & sorted_erased) override;
+		/// clears view, also notifies predicates caching per record data, see invalidate_predicate
+		virtual void clear_view() override;
 		
 	protected:
 		/// adjusts view with erased/updated/inserted data, preserving filter/sort order. stable,
@@ -107,6 +212,63 @@ namespace viewed
 			store_iterator first_inserted, store_iterator last,
 			signal_const_iterator first_erased, signal_const_iterator last_erased);
 
+		/// true if range of size records should be sorted in parallel, see set_parallel_sort_threshold
+		bool use_parallel_sort(std::ptrdiff_t size) const noexcept
+		{
+			return m_parallel_sort_threshold and static_cast<std::size_t>(size) >= m_parallel_sort_threshold;
+		}
+
+		parallel_sort_pool & sort_pool() const { return m_sort_pool ? *m_sort_pool : default_parallel_sort_pool(); }
+
+		/// true if range of size records should be filtered in parallel, see set_parallel_filter_threshold
+		bool use_parallel_filter(std::size_t size) const noexcept
+		{
+			return m_parallel_filter_threshold and active(m_filter_pred) and size >= m_parallel_filter_threshold;
+		}
+
+		parallel_sort_pool & filter_pool() const { return m_filter_pool ? *m_filter_pool : default_parallel_sort_pool(); }
+
+		/// schedules process_refilter_slice call on next event loop iteration via QTimer::singleShot(0, get_model(), ...),
+		/// slices are rescheduled while refilter is pending. Model must not outlive view with pending refilter
+		virtual void schedule_refilter_slice();
+		/// called after each asynchronous refilter slice with refilter_progress values, can be used to emit progress signal.
+		/// Default implementation does nothing
+		virtual void refilter_progress_changed(std::size_t done, std::size_t total) {}
+
+		/// starts asynchronous refilter of rtype, cancelling pending one, see filter_by_async
+		virtual void start_async_refilter(refilter_type rtype);
+		/// stops pending asynchronous refilter without publishing result
+		void cancel_async_refilter() noexcept;
+		/// publishes result of completed asynchronous refilter
+		virtual void publish_async_refilter();
+		/// excludes erased and updated records from pending asynchronous refilter:
+		/// they are already processed with current filter by update_data/erase_records
+		void exclude_async_records(const signal_range_type & sorted_erased, const signal_range_type & sorted_updated);
+
+		/// remembers current m_store as result of filter state prev, called by filter_by/filter_by_async when filter changes
+		void push_filter_history(filter_pred_type prev);
+		/// records erased/updated/inserted records in filter history entries, entries with too many changes are dropped
+		void note_filter_history_changes(const signal_range_type & sorted_erased, const signal_range_type & sorted_updated, const signal_range_type & inserted);
+		/// if filter history has entry for current m_filter_pred - restores it's result and returns true,
+		/// emits same signals as refilter_full_and_notify
+		virtual bool restore_filter_history();
+
+		/// removes rows [erased_first, erased_last)(sorted) from m_store
+		/// emits qt beginRemoveRows/endRemoveRows for few removed runs, see notify_row_changes,
+		/// otherwise layoutAboutToBeChanged(..., NoLayoutChangeHint), layoutUpdated(..., NoLayoutChangeHint)
+		void remove_rows_and_notify(int_vector_iterator erased_first, int_vector_iterator erased_last);
+		/// merges sorted_records(sorted by pointer, all owner records) into m_store via update_store, as refilter_full_and_notify does.
+		/// passes - filter results parallel to sorted_records, empty - filter is evaluated by update_store
+		void refilter_records_and_notify(const store_type & sorted_records, std::vector<char> passes);
+
+		/// if m_sort_pred exposes key projection(see sort_key_projection.hpp) - sorts [first, last) by projected keys and returns true,
+		/// otherwise does nothing and returns false. ifirst - index range to permute the same way, or nullptr
+		template <class IndexIterator>
+		bool sort_by_keys(store_iterator first, store_iterator last, IndexIterator ifirst);
+		/// same as sort_by_keys, but merges [middle, last) into [first, last), see merge_newdata
+		template <class IndexIterator>
+		bool merge_by_keys(store_iterator first, store_iterator middle, store_iterator last, IndexIterator ifirst, bool resort_old);
+
 		/// merges m_store's [middle, last) into [first, last) according to m_sort_pred. stable.
 		/// first, middle, last - is are one range, as in std::inplace_merge
 		/// if resort_old is true it also resorts [first, middle), otherwise it's assumed it's sorted
@@ -144,7 +306,8 @@ namespace viewed
 		/// * full        - calls refilter_incremental_and_notify
 		virtual void refilter_and_notify(refilter_type rtype);
 		/// removes elements not passing m_filter_pred from m_store
-		/// emits qt layoutAboutToBeChanged(..., NoLayoutChangeHint), layoutUpdated(..., NoLayoutChangeHint)
+		/// emits qt beginRemoveRows/endRemoveRows for few removed runs, see notify_row_changes,
+		/// otherwise layoutAboutToBeChanged(..., NoLayoutChangeHint), layoutUpdated(..., NoLayoutChangeHint)
 		virtual void refilter_incremental_and_notify();
 		/// fills m_store from owner with values passing m_filter_pred and sorts them according to m_sort_pred
 		/// emits qt layoutAboutToBeChanged(..., NoLayoutChangeHint), layoutUpdated(..., NoLayoutChangeHint)
@@ -154,7 +317,15 @@ namespace viewed
 		const auto & sort_pred()   const { return m_sort_pred; }
 		const auto & filter_pred() const { return m_filter_pred; }
 
+		/// sets filter expression via m_filter_pred.set_expr(args...) and refilters view synchronously.
+		/// Pending asynchronous refilter is cancelled and done synchronously as part of this one
 		template <class ... Args> auto filter_by(Args && ... args) -> refilter_type;
+		/// sets filter expression via m_filter_pred.set_expr(args...) and refilters view asynchronously:
+		/// filter is evaluated in slices across event loop iterations(see set_refilter_slice_budget, schedule_refilter_slice),
+		/// view keeps old rows until all records are evaluated, then result is published at once, with same signals as filter_by.
+		/// Newer filter_by_async/filter_by call cancels refilter in flight. Container updates are processed meanwhile as usual,
+		/// with new filter. Progress - refilter_pending, refilter_progress, refilter_progress_changed.
+		template <class ... Args> auto filter_by_async(Args && ... args) -> refilter_type;
 		template <class ... Args> void sort_by(Args && ... args);
 
 	public:
@@ -179,12 +350,22 @@ namespace viewed
 	template <class Container, class SortPred, class FilterPred>
 	void sfview_qtbase<Container, SortPred, FilterPred>::reinit_view()
 	{
+		// view is filtered from scratch with current filter
+		cancel_async_refilter();
+		m_filter_history.clear();
+
 		auto * model = this->get_model();
 		model->beginResetModel();
 
 		auto range = *m_owner | boost::adaptors::transformed(get_view_pointer);
 		if (not active(m_filter_pred))
 			m_store.assign(range.begin(), range.end());
+		else if (use_parallel_filter(m_owner->size()))
+		{
+			m_store.assign(range.begin(), range.end());
+			auto pred = viewed::make_indirect_fun(m_filter_pred);
+			m_store.erase(viewed::parallel_filter(m_store.begin(), m_store.end(), pred, filter_pool()), m_store.end());
+		}
 		else
 		{
 			m_store.clear();
@@ -193,6 +374,7 @@ namespace viewed
 		}
 
 		stable_sort(m_store.begin(), m_store.end());
+		invalidate_row_index();
 
 		model->endResetModel();
 	}
@@ -203,6 +385,11 @@ namespace viewed
 		const signal_range_type & sorted_updated,
 		const signal_range_type & inserted)
 	{
+		viewed::invalidate_predicate(m_sort_pred, sorted_erased, sorted_updated);
+		viewed::invalidate_predicate(m_filter_pred, sorted_erased, sorted_updated);
+		exclude_async_records(sorted_erased, sorted_updated);
+		note_filter_history_changes(sorted_erased, sorted_updated, inserted);
+
 		if (not active(m_sort_pred) and not active(m_filter_pred))
 			base_type::update_data(sorted_erased, sorted_updated, inserted);
 		else
@@ -220,6 +407,29 @@ namespace viewed
 		}
 	}
 
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::erase_records(const signal_range_type & sorted_erased)
+	{
+		signal_range_type none;
+		viewed::invalidate_predicate(m_sort_pred, sorted_erased, none);
+		viewed::invalidate_predicate(m_filter_pred, sorted_erased, none);
+		exclude_async_records(sorted_erased, none);
+		note_filter_history_changes(sorted_erased, none, none);
+
+		base_type::erase_records(sorted_erased);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::clear_view()
+	{
+		viewed::invalidate_predicate(m_sort_pred);
+		viewed::invalidate_predicate(m_filter_pred);
+		cancel_async_refilter();
+		m_filter_history.clear();
+
+		base_type::clear_view();
+	}
+
 	template <class Container, class SortPred, class FilterPred>
 	void sfview_qtbase<Container, SortPred, FilterPred>::update_store(
 		store_iterator first, store_iterator first_updated,
@@ -270,20 +480,102 @@ namespace viewed
 		auto     fpred = [this](auto ptr) { return m_filter_pred(*ptr); };
 		//auto not_fpred = [this](auto ptr) { return not m_filter_pred(*ptr); };
 
+		// filter result of updated record at it, precomputed one if provided, see m_updated_passes
+		assert(m_updated_passes.empty() or m_updated_passes.size() == static_cast<std::size_t>(first_inserted - first_updated));
+		auto updated_passes = [this, first_updated](store_iterator it, view_pointer_type ptr) -> bool
+		{
+			return m_updated_passes.empty() ? m_filter_pred(*ptr) : m_updated_passes[it - first_updated];
+		};
+
+		// copies not marked updated records passing filter to out
+		auto copy_updated = [&updated_passes](store_iterator first, store_iterator last, store_iterator out)
+		{
+			for (auto it = first; it != last; ++it)
+				if (not viewed::marked_pointer(*it) and updated_passes(it, *it)) *out++ = *it;
+
+			return out;
+		};
+
 		int_vector index_array, affected_indexes;
 		int_vector_iterator removed_first, removed_last, changed_first, changed_last;
 		std::size_t middle_sz = first_updated - first;
 		bool order_changed = false;
 
+		// changed fields masks are parallel to [first_updated, first_inserted), if provided
+		auto updated_fields = this->updated_fields();
+		bool use_fields = not updated_fields.empty() and updated_fields.size() == static_cast<std::size_t>(first_inserted - first_updated);
+		auto sort_fields = viewed::predicate_fields(m_sort_pred);
+		field_mask_vector changed_fields;
+
 		auto middle = first_updated;
 		auto last_updated = first_inserted;
 		auto last_inserted = last;
+
+		// records of removed rows, in old order, needed for fine grained qt signals, see notify_row_changes
+		store_type removed_records;
+		auto save_removed = [&]
+		{
+			for (auto it = removed_first; it != removed_last; ++it)
+				removed_records.push_back(first[*it]);
+		};
 		
 		affected_indexes.resize(first_inserted - first_updated + last_erased - first_erased);
 		removed_first = removed_last = affected_indexes.begin();
 		changed_first = changed_last = affected_indexes.end();
 
-		if (first_updated == last_updated)
+		if (this->m_row_index_enabled)
+		{
+			// rows of erased and updated records are looked up via row index: O(erased + updated) instead of N * log M,
+			// if index is stale(rows were moved by previous update) it's rebuilt first, see enable_row_index
+			this->ensure_row_index(middle_sz);
+			for (auto it = first_erased; it != last_erased; ++it)
+			{
+				int row = lookup_row(*it);
+				if (row >= 0) *removed_last++ = row;
+			}
+
+			std::vector<std::pair<int, field_mask_type>> changed;
+			for (auto it = first_updated; it != last_updated; ++it)
+			{
+				auto ptr = *it;
+				int row = lookup_row(ptr);
+				if (row < 0) continue;
+
+				*it = viewed::mark_pointer(ptr);
+				bool passes = not active(m_filter_pred) or updated_passes(it, ptr);
+
+				if (not passes) *removed_last++ = row;
+				else            changed.emplace_back(row, use_fields ? updated_fields[it - first_updated] : all_fields);
+			}
+
+			std::sort(removed_first, removed_last);
+			std::sort(changed.begin(), changed.end());
+
+			changed_first = changed_last - changed.size();
+			for (std::size_t idx = 0; idx < changed.size(); ++idx)
+				changed_first[idx] = changed[idx].first;
+
+			if (not use_fields)
+			{
+				order_changed = not changed.empty();
+				emit_changed(changed_first, changed_last);
+			}
+			else
+			{
+				for (auto & item : changed)
+				{
+					changed_fields.push_back(item.second);
+					order_changed |= (item.second & sort_fields) != 0;
+				}
+
+				emit_changed(changed_first, changed_last, changed_fields.cbegin());
+			}
+
+			save_removed();
+			middle = viewed::remove_indexes(first, middle, removed_first, removed_last);
+			last = copy_updated(first_updated, last_updated, middle);
+		}
+		else if (first_updated == last_updated)
 		{
 			// if there erased ones - erase them from the store
 			for (auto it = first; it != middle; ++it)
@@ -292,6 +584,7 @@ namespace viewed
 					*removed_last++ = static_cast<int>(it - first);
 			}
 
+			save_removed();
 			last = middle = viewed::remove_indexes(first, middle, removed_first, removed_last);
 		}
 		else // there are updates
@@ -309,20 +602,36 @@ namespace viewed
 
 					*found = viewed::mark_pointer(*found);
 					int row = static_cast<int>(it - first);
-					bool passes = not active(m_filter_pred) or m_filter_pred(*ptr);
-
-					if (passes)   *--changed_first = row;
-					else          *removed_last++ = row;
+					bool passes = not active(m_filter_pred) or updated_passes(found, ptr);
+
+					if (not passes)   *removed_last++ = row;
+					else
+					{
+						*--changed_first = row;
+						if (not use_fields) continue;
+
+						auto fields = updated_fields[found - first_updated];
+						changed_fields.push_back(fields);
+						order_changed |= (fields & sort_fields) != 0;
+					}
 				}
 			}
 
-			order_changed = changed_first != changed_last;
 			std::reverse(changed_first, changed_last);
-			emit_changed(changed_first, changed_last);
+			if (not use_fields)
+			{
+				order_changed = changed_first != changed_last;
+				emit_changed(changed_first, changed_last);
+			}
+			else
+			{
+				std::reverse(changed_fields.begin(), changed_fields.end());
+				emit_changed(changed_first, changed_last, changed_fields.cbegin());
+			}
 			
+			save_removed();
 			middle = viewed::remove_indexes(first, middle, removed_first, removed_last);
-			last = std::copy_if(first_updated, last_updated, middle,
-			                    [fpred](auto ptr) { return not viewed::marked_pointer(ptr) and fpred(ptr); });
+			last = copy_updated(first_updated, last_updated, middle);
 		}
 
 		// copy filter new elements
@@ -335,9 +644,11 @@ namespace viewed
 		middle_sz = middle - first;
 		m_store.resize(last - first);
 
+		// only some not sort affecting fields were changed - nothing to do more
+		if (not order_changed and removed_first == removed_last and last == middle)
+			return;
 
-		auto * model = get_model();
-		Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+		invalidate_row_index();
 
 		first = m_store.begin();
 		middle = first + middle_sz;
@@ -360,8 +671,23 @@ namespace viewed
 		);
 
 		viewed::inverse_index_array(ifirst, ilast, offset);
-		change_indexes(ifirst, ilast, offset);
 
+		// first middle_sz + removed entries are old rows, rest are new rows of inserted records
+		auto old_size = middle_sz + (removed_last - removed_first);
+		if (not order_changed)
+		{
+			// surviving records are not reordered
+			int_vector removed_rows(removed_first, removed_last), inserted_rows(ifirst + old_size, ilast);
+			std::sort(inserted_rows.begin(), inserted_rows.end());
+			if (notify_row_changes(removed_rows, removed_records, inserted_rows))
+				return;
+		}
+		else if (notify_row_changes(ifirst, ifirst + old_size, removed_records))
+			return;
+
+		auto * model = get_model();
+		Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+		change_indexes(ifirst, ilast, offset);
 		Q_EMIT model->layoutChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
 	}
 
@@ -370,12 +696,21 @@ namespace viewed
 		merge_newdata(store_iterator first, store_iterator middle, store_iterator last, bool resort_old /*= true*/)
 	{
 		if (not active(m_sort_pred)) return;
+		if (merge_by_keys(first, middle, last, nullptr, resort_old)) return;
 
 		auto comp = viewed::make_indirect_fun(m_sort_pred);
 
-		if (resort_old) varalgo::stable_sort(first, middle, comp);
-		varalgo::sort(middle, last, comp);
-		varalgo::inplace_merge(first, middle, last, comp);
+		if (resort_old)
+		{
+			if (use_parallel_sort(middle - first)) viewed::parallel_stable_sort(first, middle, comp, sort_pool());
+			else                                   varalgo::stable_sort(first, middle, comp);
+		}
+
+		if (use_parallel_sort(last - middle)) viewed::parallel_stable_sort(middle, last, comp, sort_pool());
+		else                                  varalgo::sort(middle, last, comp);
+
+		if (use_parallel_sort(last - first)) viewed::parallel_inplace_merge(first, middle, last, comp, sort_pool());
+		else                                 varalgo::inplace_merge(first, middle, last, comp);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
@@ -388,6 +723,7 @@ namespace viewed
 
 		assert(last - first == ilast - ifirst);
 		assert(middle - first == imiddle - ifirst);
+		if (merge_by_keys(first, middle, last, ifirst, resort_old)) return;
 
 		auto comp = viewed::make_get_functor<0>(viewed::make_indirect_fun(m_sort_pred));
 
@@ -395,18 +731,28 @@ namespace viewed
 		auto zmiddle = ext::make_zip_iterator(middle, imiddle);
 		auto zlast   = ext::make_zip_iterator(last, ilast);
 
-		if (resort_old) varalgo::stable_sort(zfirst, zmiddle, comp);
-		varalgo::sort(zmiddle, zlast, comp);
-		varalgo::inplace_merge(zfirst, zmiddle, zlast, comp);
+		if (resort_old)
+		{
+			if (use_parallel_sort(middle - first)) viewed::parallel_stable_sort(zfirst, zmiddle, comp, sort_pool());
+			else                                   varalgo::stable_sort(zfirst, zmiddle, comp);
+		}
+
+		if (use_parallel_sort(last - middle)) viewed::parallel_stable_sort(zmiddle, zlast, comp, sort_pool());
+		else                                  varalgo::sort(zmiddle, zlast, comp);
+
+		if (use_parallel_sort(last - first)) viewed::parallel_inplace_merge(zfirst, zmiddle, zlast, comp, sort_pool());
+		else                                 varalgo::inplace_merge(zfirst, zmiddle, zlast, comp);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
 	void sfview_qtbase<Container, SortPred, FilterPred>::stable_sort(store_iterator first, store_iterator last)
 	{
 		if (not active(m_sort_pred)) return;
+		if (sort_by_keys(first, last, nullptr)) return;
 
 		auto comp = viewed::make_indirect_fun(m_sort_pred);
-		varalgo::stable_sort(first, last, comp);
+		if (use_parallel_sort(last - first)) viewed::parallel_stable_sort(first, last, comp, sort_pool());
+		else                                 varalgo::stable_sort(first, last, comp);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
@@ -415,12 +761,72 @@ namespace viewed
 	         int_vector_iterator ifirst, int_vector_iterator ilast)
 	{
 		if (not active(m_sort_pred)) return;
+		if (sort_by_keys(first, last, ifirst)) return;
 
 		auto comp = viewed::make_get_functor<0>(viewed::make_indirect_fun(m_sort_pred));
 
 		auto zfirst = ext::make_zip_iterator(first, ifirst);
 		auto zlast = ext::make_zip_iterator(last, ilast);
-		varalgo::stable_sort(zfirst, zlast, comp);
+
+		if (use_parallel_sort(last - first)) viewed::parallel_stable_sort(zfirst, zlast, comp, sort_pool());
+		else                                 varalgo::stable_sort(zfirst, zlast, comp);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	template <class IndexIterator>
+	bool sfview_qtbase<Container, SortPred, FilterPred>::
+		sort_by_keys(store_iterator first, store_iterator last, IndexIterator ifirst)
+	{
+		auto alg = [&](const auto & pred) -> bool
+		{
+			using pred_type = std::decay_t<decltype(pred)>;
+			if constexpr (not viewed::has_sort_key_v<pred_type, value_type>)
+				return false;
+			else
+			{
+				auto entries = viewed::project_sort_keys(pred, first, last);
+				viewed::sort_key_entries(entries, use_parallel_sort(last - first) ? &sort_pool() : nullptr);
+
+				if constexpr (std::is_null_pointer_v<IndexIterator>) viewed::apply_key_entries(entries, first);
+				else                                                 viewed::apply_key_entries(entries, first, ifirst);
+
+				return true;
+			}
+		};
+
+		return varalgo::variant_traits<sort_pred_type>::visit(alg, m_sort_pred);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	template <class IndexIterator>
+	bool sfview_qtbase<Container, SortPred, FilterPred>::
+		merge_by_keys(store_iterator first, store_iterator middle, store_iterator last, IndexIterator ifirst, bool resort_old)
+	{
+		auto alg = [&](const auto & pred) -> bool
+		{
+			using pred_type = std::decay_t<decltype(pred)>;
+			if constexpr (not viewed::has_sort_key_v<pred_type, value_type>)
+				return false;
+			else
+			{
+				std::size_t middle_sz = middle - first;
+				auto entries = viewed::project_sort_keys(pred, first, middle);
+				auto new_entries = viewed::project_sort_keys(pred, middle, last, middle_sz);
+
+				if (resort_old) viewed::sort_key_entries(entries, use_parallel_sort(middle - first) ? &sort_pool() : nullptr);
+				viewed::sort_key_entries(new_entries, use_parallel_sort(last - middle) ? &sort_pool() : nullptr);
+
+				entries.insert(entries.end(), std::make_move_iterator(new_entries.begin()), std::make_move_iterator(new_entries.end()));
+				viewed::merge_key_entries(entries, middle_sz, use_parallel_sort(last - first) ? &sort_pool() : nullptr);
+
+				if constexpr (std::is_null_pointer_v<IndexIterator>) viewed::apply_key_entries(entries, first);
+				else                                                 viewed::apply_key_entries(entries, first, ifirst);
+
+				return true;
+			}
+		};
+
+		return varalgo::variant_traits<sort_pred_type>::visit(alg, m_sort_pred);
 	}
 
 	template <class Container, class SortPred, class FilterPred>
@@ -483,15 +889,31 @@ namespace viewed
 		for (auto it = std::find_if(first, last, test); it != last; it = std::find_if(++it, last, test))
 			*erased_last++ = static_cast<int>(it - first);
 
-		auto * model = get_model();
-		Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+		remove_rows_and_notify(erased_first, erased_last);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::remove_rows_and_notify(int_vector_iterator erased_first, int_vector_iterator erased_last)
+	{
+		if (erased_first == erased_last) return;
+
+		auto first = m_store.begin();
+		auto last = m_store.end();
 
 		auto index_map = viewed::build_relloc_map(erased_first, erased_last, m_store.size());
-		change_indexes(index_map.begin(), index_map.end(), 0);
+		int_vector removed_rows(erased_first, erased_last);
+		store_type removed;
+		for (int row : removed_rows) removed.push_back(m_store[row]);
 
 		last = viewed::remove_indexes(first, last, erased_first, erased_last);
 		m_store.resize(last - first);
 
+		if (notify_row_changes(removed_rows, removed, {}))
+			return;
+
+		auto * model = get_model();
+		Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+		change_indexes(index_map.begin(), index_map.end(), 0);
 		Q_EMIT model->layoutChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
 	}
 
@@ -500,27 +922,321 @@ namespace viewed
 	{
 		if (not active(m_sort_pred) and not active(m_filter_pred))
 			base_type::reinit_view();
-		else
+		else if (not restore_filter_history())
 		{
-			auto sz = m_store.size();
-			boost::push_back(m_store, *m_owner | boost::adaptors::transformed(get_view_pointer));
+			store_type records;
+			boost::push_back(records, *m_owner | boost::adaptors::transformed(get_view_pointer));
+			std::sort(records.begin(), records.end());
 
-			auto first = m_store.begin();
-			auto last = m_store.end();
-			auto first_updated = first + sz;
-			std::sort(first_updated, last);
+			// filter is evaluated for all owner records in parallel before update_store, see m_updated_passes
+			std::vector<char> passes;
+			if (use_parallel_filter(records.size()))
+			{
+				auto pred = viewed::make_indirect_fun(m_filter_pred);
+				viewed::parallel_filter_bitmap(records.begin(), records.end(), pred, passes, filter_pool());
+			}
+
+			refilter_records_and_notify(records, std::move(passes));
+		}
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::refilter_records_and_notify(const store_type & sorted_records, std::vector<char> passes)
+	{
+		auto sz = m_store.size();
+		m_store.insert(m_store.end(), sorted_records.begin(), sorted_records.end());
+
+		auto first = m_store.begin();
+		auto last = m_store.end();
+		auto first_updated = first + sz;
 
-			signal_const_iterator noerased {};
+		m_updated_passes = std::move(passes);
+		signal_const_iterator noerased {};
+		try
+		{
 			update_store(first, first_updated, last, last, noerased, noerased);
+			m_updated_passes.clear();
+		}
+		catch (...)
+		{
+			m_updated_passes.clear();
+			throw;
+		}
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::schedule_refilter_slice()
+	{
+		if (m_refilter_scheduled) return;
+
+		m_refilter_scheduled = true;
+		QTimer::singleShot(0, get_model(), [this]
+		{
+			m_refilter_scheduled = false;
+			if (process_refilter_slice()) schedule_refilter_slice();
+		});
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::start_async_refilter(refilter_type rtype)
+	{
+		// refilter in flight is restarted, it's result is not published yet: combined type is the widest one
+		if (refilter_pending())
+			rtype = std::max(rtype, m_async_rtype);
+
+		cancel_async_refilter();
+		if (rtype == refilter_type::same) return;
+
+		if (rtype == refilter_type::incremental)
+		{
+			// narrowing: only current records can be filtered out
+			if (not active(m_filter_pred)) return;
+			m_async_records = m_store;
+		}
+		else if (not active(m_sort_pred) and not active(m_filter_pred))
+			return base_type::reinit_view();
+		else if (restore_filter_history())
+			// remembered result is restored synchronously, only changed records are evaluated
+			return;
+		else
+		{
+			boost::push_back(m_async_records, *m_owner | boost::adaptors::transformed(get_view_pointer));
+			std::sort(m_async_records.begin(), m_async_records.end());
+		}
+
+		m_async_passes.reserve(m_async_records.size());
+		m_async_rtype = rtype;
+
+		schedule_refilter_slice();
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::cancel_async_refilter() noexcept
+	{
+		m_async_rtype = refilter_type::same;
+		m_async_records.clear();
+		m_async_passes.clear();
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	bool sfview_qtbase<Container, SortPred, FilterPred>::process_refilter_slice()
+	{
+		if (not refilter_pending()) return false;
+
+		// clock is checked after every step records
+		constexpr std::size_t step = 64;
+		auto deadline = std::chrono::steady_clock::now() + m_refilter_slice_budget;
+		auto total = m_async_records.size();
+
+		do {
+			auto pos = m_async_passes.size();
+			auto step_last = std::min(total, pos + step);
+
+			for (; pos != step_last; ++pos)
+				m_async_passes.push_back(not active(m_filter_pred) or m_filter_pred(*m_async_records[pos]));
+
+		} while (m_async_passes.size() != total and std::chrono::steady_clock::now() < deadline);
+
+		refilter_progress_changed(m_async_passes.size(), total);
+		if (m_async_passes.size() != total) return true;
+
+		publish_async_refilter();
+		return false;
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::finish_refilter()
+	{
+		while (process_refilter_slice())
+			continue;
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::publish_async_refilter()
+	{
+		auto rtype = m_async_rtype;
+		auto records = std::move(m_async_records);
+		auto passes = std::move(m_async_passes);
+		cancel_async_refilter();
+
+		if (rtype == refilter_type::full)
+			return refilter_records_and_notify(records, std::move(passes));
+
+		// incremental: remove records failed filter, records inserted meanwhile are already filtered.
+		int_vector erased_rows;
+		if (records == m_store)
+		{
+			// common case - view is not changed meanwhile, passes are parallel to rows
+			for (std::size_t row = 0; row < passes.size(); ++row)
+				if (not passes[row]) erased_rows.push_back(static_cast<int>(row));
 		}
+		else
+		{
+			for (auto & pass : passes) pass = not pass;
+			records.erase(viewed::compact_by_bitmap(records.begin(), records.end(), passes), records.end());
+			std::sort(records.begin(), records.end());
+
+			for (std::size_t row = 0; row < m_store.size(); ++row)
+				if (std::binary_search(records.begin(), records.end(), m_store[row]))
+					erased_rows.push_back(static_cast<int>(row));
+		}
+
+		remove_rows_and_notify(erased_rows.begin(), erased_rows.end());
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::exclude_async_records(const signal_range_type & sorted_erased, const signal_range_type & sorted_updated)
+	{
+		if (not refilter_pending() or (sorted_erased.empty() and sorted_updated.empty())) return;
+
+		auto excluded = [&](view_pointer_type ptr)
+		{
+			return std::binary_search(sorted_erased.begin(), sorted_erased.end(), ptr)
+			    or std::binary_search(sorted_updated.begin(), sorted_updated.end(), ptr);
+		};
+
+		std::size_t size = m_async_records.size(), evaluated = m_async_passes.size(), out = 0, out_evaluated = 0;
+		for (std::size_t idx = 0; idx < size; ++idx)
+		{
+			auto * ptr = m_async_records[idx];
+			if (excluded(ptr)) continue;
+
+			if (idx < evaluated) m_async_passes[out_evaluated++] = m_async_passes[idx];
+			m_async_records[out++] = ptr;
+		}
+
+		m_async_records.resize(out);
+		m_async_passes.resize(out_evaluated);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::set_filter_history_depth(std::size_t depth)
+	{
+		m_filter_history_depth = depth;
+		if (m_filter_history.size() > depth)
+			m_filter_history.erase(m_filter_history.begin(), m_filter_history.end() - depth);
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::push_filter_history(filter_pred_type prev)
+	{
+		if (not m_filter_history_depth) return;
+
+		// same state is remembered once, with latest result
+		auto same = [&prev](const filter_history_entry & entry) { return viewed::predicates_equal(entry.filter, prev); };
+		m_filter_history.erase(std::remove_if(m_filter_history.begin(), m_filter_history.end(), same), m_filter_history.end());
+
+		if (m_filter_history.size() == m_filter_history_depth)
+			m_filter_history.erase(m_filter_history.begin());
+
+		m_filter_history.push_back({std::move(prev), m_store, {}});
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	void sfview_qtbase<Container, SortPred, FilterPred>::note_filter_history_changes(
+		const signal_range_type & sorted_erased, const signal_range_type & sorted_updated, const signal_range_type & inserted)
+	{
+		if (m_filter_history.empty()) return;
+
+		for (auto & entry : m_filter_history)
+		{
+			for (auto * ptr : sorted_erased)  entry.changes.emplace_back(ptr, false);
+			for (auto * ptr : sorted_updated) entry.changes.emplace_back(ptr, true);
+			for (auto * ptr : inserted)       entry.changes.emplace_back(ptr, true);
+		}
+
+		// restoring entry with many changes is not much cheaper than full refilter
+		auto outdated = [](const filter_history_entry & entry) { return entry.changes.size() > entry.records.size() / 2 + 1024; };
+		m_filter_history.erase(std::remove_if(m_filter_history.begin(), m_filter_history.end(), outdated), m_filter_history.end());
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	bool sfview_qtbase<Container, SortPred, FilterPred>::restore_filter_history()
+	{
+		auto same = [this](const filter_history_entry & entry) { return viewed::predicates_equal(entry.filter, m_filter_pred); };
+		auto found = std::find_if(m_filter_history.rbegin(), m_filter_history.rend(), same);
+		if (found == m_filter_history.rend()) return false;
+
+		auto entry = std::move(*found);
+		m_filter_history.erase(std::next(found).base());
+
+		// last change of every record wins
+		auto & changes = entry.changes;
+		auto by_pointer = [](auto & c1, auto & c2) { return c1.first < c2.first; };
+		std::stable_sort(changes.begin(), changes.end(), by_pointer);
+
+		auto changes_last = changes.begin();
+		for (auto it = changes.begin(); it != changes.end(); ++it)
+		{
+			if (changes_last != changes.begin() and std::prev(changes_last)->first == it->first)
+				*std::prev(changes_last) = *it;
+			else
+				*changes_last++ = *it;
+		}
+
+		changes.erase(changes_last, changes.end());
+
+		// records to refilter: remembered passed ones, current ones and changed alive ones, sorted by pointer
+		auto & passed = entry.records;
+		std::sort(passed.begin(), passed.end());
+
+		store_type records;
+		records.reserve(passed.size() + m_store.size() + changes.size());
+		records.assign(passed.begin(), passed.end());
+		records.insert(records.end(), m_store.begin(), m_store.end());
+		for (auto & change : changes)
+			if (change.second) records.push_back(change.first);
+
+		std::sort(records.begin(), records.end());
+		records.erase(std::unique(records.begin(), records.end()), records.end());
+
+		// filter is evaluated only for changed records, others pass if they passed then
+		std::vector<char> passes(records.size());
+		for (std::size_t idx = 0; idx < records.size(); ++idx)
+		{
+			auto * ptr = records[idx];
+			auto change = std::lower_bound(changes.begin(), changes.end(), std::make_pair(ptr, false), by_pointer);
+
+			if (change != changes.end() and change->first == ptr)
+				passes[idx] = change->second and m_filter_pred(*ptr);
+			else
+				passes[idx] = std::binary_search(passed.begin(), passed.end(), ptr);
+		}
+
+		refilter_records_and_notify(records, std::move(passes));
+		return true;
 	}
 
 	template <class Container, class SortPred, class FilterPred>
 	template <class ... Args>
 	auto sfview_qtbase<Container, SortPred, FilterPred>::filter_by(Args && ... args) -> refilter_type
 	{
+		// m_store is result of current filter, unless asynchronous refilter is pending
+		std::optional<filter_pred_type> prev;
+		if (m_filter_history_depth and not refilter_pending()) prev = m_filter_pred;
+
+		auto rtype = m_filter_pred.set_expr(std::forward<Args>(args)...);
+		if (prev and rtype != refilter_type::same) push_filter_history(std::move(*prev));
+
+		// pending asynchronous refilter result is not published yet
+		auto effective = refilter_pending() ? std::max(rtype, m_async_rtype) : rtype;
+		cancel_async_refilter();
+		refilter_and_notify(effective);
+
+		return rtype;
+	}
+
+	template <class Container, class SortPred, class FilterPred>
+	template <class ... Args>
+	auto sfview_qtbase<Container, SortPred, FilterPred>::filter_by_async(Args && ... args) -> refilter_type
+	{
+		std::optional<filter_pred_type> prev;
+		if (m_filter_history_depth and not refilter_pending()) prev = m_filter_pred;
+
 		auto rtype = m_filter_pred.set_expr(std::forward<Args>(args)...);
-		refilter_and_notify(rtype);
+		if (prev and rtype != refilter_type::same) push_filter_history(std::move(*prev));
+
+		start_async_refilter(rtype);
 
 		return rtype;
 	}
@@ -2,6 +2,7 @@
 #include <boost/config.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <boost/signals2.hpp>
+#include <viewed/forward_types.hpp>
 
 namespace viewed
 {
@@ -23,6 +24,12 @@ namespace viewed
 		inline static signal_range_type make_range(const Type ** first, const Type ** last)
 		{ return boost::make_iterator_range(first, last); }
 
+		/// random access range of changed fields masks, parallel to sorted_updated range of update signal
+		typedef boost::iterator_range<const field_mask_type *> field_mask_range_type;
+
+		inline static field_mask_range_type make_mask_range(const field_mask_type * first, const field_mask_type * last)
+		{ return boost::make_iterator_range(first, last); }
+
 
 		typedef boost::signals2::connection          connection;
 		typedef boost::signals2::scoped_connection   scoped_connection;
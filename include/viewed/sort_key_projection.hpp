@@ -0,0 +1,188 @@
+#pragma once
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+
+#include <viewed/parallel_sort.hpp>
+
+namespace viewed
+{
+	/// Sort key projection: sort predicate can expose key projection - method key(const value_type & rec) const.
+	/// Predicate then must be equivalent to pred.key(r1) < pred.key(r2).
+	/// Views with such predicates project keys once per sort/merge into contiguous array of (key, pointer, position) entries
+	/// and sort that array, instead of dereferencing record pointers and recomputing keys in every comparison.
+	/// Integral and floating point keys are sorted with LSD radix sort, other keys - with stable sort via operator <.
+	///
+	///   struct by_name
+	///   {
+	///       QString key(const record & rec) const { return rec.name.toLower(); }
+	///       bool operator()(const record & r1, const record & r2) const { return key(r1) < key(r2); }
+	///   };
+
+	template <class Pred, class Value, class = void>
+	struct has_sort_key : std::false_type {};
+
+	template <class Pred, class Value>
+	struct has_sort_key<Pred, Value, std::void_t<decltype(std::declval<const Pred &>().key(std::declval<const Value &>()))>>
+		: std::true_type {};
+
+	template <class Pred, class Value>
+	constexpr bool has_sort_key_v = has_sort_key<Pred, Value>::value;
+
+	template <class Pred, class Value>
+	using sort_key_t = std::decay_t<decltype(std::declval<const Pred &>().key(std::declval<const Value &>()))>;
+
+	/// keys sorted via radix sort
+	template <class Key>
+	constexpr bool radix_sortable_v = (std::is_integral_v<Key> or std::is_floating_point_v<Key>) and sizeof(Key) <= sizeof(std::uint64_t);
+
+	template <class Key, class Pointer>
+	struct sort_key_entry
+	{
+		Key key;
+		Pointer ptr;
+		std::size_t pos; // position in projected range
+	};
+
+	namespace detail
+	{
+		template <std::size_t Size> struct radix_uint;
+		template <> struct radix_uint<1> { using type = std::uint8_t;  };
+		template <> struct radix_uint<2> { using type = std::uint16_t; };
+		template <> struct radix_uint<4> { using type = std::uint32_t; };
+		template <> struct radix_uint<8> { using type = std::uint64_t; };
+
+		/// maps key to unsigned integer with same order
+		template <class Key>
+		auto radix_bits(Key key) noexcept
+		{
+			using uint = typename radix_uint<sizeof(Key)>::type;
+			constexpr uint sign = uint(1) << (sizeof(Key) * CHAR_BIT - 1);
+
+			if constexpr (std::is_floating_point_v<Key>)
+			{
+				if (key == 0) key = 0; // -0.0 == +0.0
+
+				uint bits;
+				std::memcpy(&bits, &key, sizeof(key));
+				return static_cast<uint>(bits & sign ? ~bits : bits | sign);
+			}
+			else if constexpr (std::is_signed_v<Key>)
+				return static_cast<uint>(static_cast<uint>(key) ^ sign);
+			else
+				return static_cast<uint>(key);
+		}
+
+		/// LSD radix sort by bytes, stable. Passes where all keys have same byte are skipped
+		template <class Entry>
+		void radix_sort(std::vector<Entry> & entries)
+		{
+			using uint = decltype(radix_bits(entries.front().key));
+			constexpr std::size_t passes = sizeof(uint);
+
+			auto size = entries.size();
+			std::vector<uint> bits(size), bits_buffer(size);
+			std::vector<Entry> buffer(size);
+			std::array<std::array<std::size_t, 256>, passes> counts = {};
+
+			for (std::size_t idx = 0; idx < size; ++idx)
+			{
+				auto val = bits[idx] = radix_bits(entries[idx].key);
+				for (std::size_t pass = 0; pass < passes; ++pass)
+					++counts[pass][(val >> (pass * 8)) & 0xFF];
+			}
+
+			for (std::size_t pass = 0; pass < passes; ++pass)
+			{
+				auto & count = counts[pass];
+				auto shift = pass * 8;
+				if (count[(bits[0] >> shift) & 0xFF] == size) continue;
+
+				std::size_t offset = 0;
+				for (auto & c : count)
+					offset += std::exchange(c, offset);
+
+				for (std::size_t idx = 0; idx < size; ++idx)
+				{
+					auto pos = count[(bits[idx] >> shift) & 0xFF]++;
+					buffer[pos] = std::move(entries[idx]);
+					bits_buffer[pos] = bits[idx];
+				}
+
+				entries.swap(buffer);
+				bits.swap(bits_buffer);
+			}
+		}
+	}
+
+	/// projects keys of records pointed by [first, last), entries positions start from offset
+	template <class Pred, class PointerIterator>
+	auto project_sort_keys(const Pred & pred, PointerIterator first, PointerIterator last, std::size_t offset = 0)
+	{
+		using pointer = typename std::iterator_traits<PointerIterator>::value_type;
+		using value_type = std::remove_cv_t<std::remove_pointer_t<pointer>>;
+		using entry_type = sort_key_entry<sort_key_t<Pred, value_type>, pointer>;
+
+		std::vector<entry_type> entries;
+		entries.reserve(last - first);
+
+		for (std::size_t pos = offset; first != last; ++first, ++pos)
+			entries.push_back(entry_type {pred.key(**first), *first, pos});
+
+		return entries;
+	}
+
+	/// stable sorts entries by key: radix sort for arithmetic keys,
+	/// parallel_stable_sort if pool is given, std::stable_sort otherwise
+	template <class Entry>
+	void sort_key_entries(std::vector<Entry> & entries, parallel_sort_pool * pool = nullptr)
+	{
+		if (entries.size() < 2) return;
+
+		if constexpr (radix_sortable_v<decltype(Entry::key)>)
+			detail::radix_sort(entries);
+		else
+		{
+			auto comp = [](const Entry & e1, const Entry & e2) { return e1.key < e2.key; };
+			if (pool) viewed::parallel_stable_sort(entries.begin(), entries.end(), comp, *pool);
+			else      std::stable_sort(entries.begin(), entries.end(), comp);
+		}
+	}
+
+	/// stable merges sorted entries [0, middle) and [middle, size)
+	template <class Entry>
+	void merge_key_entries(std::vector<Entry> & entries, std::size_t middle, parallel_sort_pool * pool = nullptr)
+	{
+		auto comp = [](const Entry & e1, const Entry & e2) { return e1.key < e2.key; };
+		if (pool) viewed::parallel_inplace_merge(entries.begin(), entries.begin() + middle, entries.end(), comp, *pool);
+		else      std::inplace_merge(entries.begin(), entries.begin() + middle, entries.end(), comp);
+	}
+
+	/// writes sorted entries pointers back to [first, ...) and permutes index range [ifirst, ...) the same way
+	template <class Entry, class PointerIterator, class IndexIterator>
+	void apply_key_entries(const std::vector<Entry> & entries, PointerIterator first, IndexIterator ifirst)
+	{
+		using index_type = typename std::iterator_traits<IndexIterator>::value_type;
+		std::vector<index_type> indexes(ifirst, ifirst + entries.size());
+
+		for (auto & entry : entries)
+		{
+			*first++ = entry.ptr;
+			*ifirst++ = indexes[entry.pos];
+		}
+	}
+
+	template <class Entry, class PointerIterator>
+	void apply_key_entries(const std::vector<Entry> & entries, PointerIterator first)
+	{
+		for (auto & entry : entries)
+			*first++ = entry.ptr;
+	}
+}
@@ -0,0 +1,303 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <unordered_set>
+
+namespace viewed
+{
+	namespace detail
+	{
+		template <class Container, class = void>
+		struct has_hash_keys : std::false_type {};
+
+		template <class Container>
+		struct has_hash_keys<Container, std::void_t<typename Container::hasher, typename Container::key_equal>> : std::true_type {};
+
+		template <class Container, class = void>
+		struct has_ordered_keys : std::false_type {};
+
+		template <class Container>
+		struct has_ordered_keys<Container, std::void_t<typename Container::key_compare>> : std::true_type {};
+
+		template <class Container, class = void>
+		struct has_upsert : std::false_type {};
+
+		template <class Container>
+		struct has_upsert<Container, std::void_t<decltype(std::declval<Container &>().upsert(
+			std::declval<typename Container::value_type *>(), std::declval<typename Container::value_type *>()))>> : std::true_type {};
+	}
+
+	/// Multi-producer staging buffer in front of viewed container(hash_container_base, ordered_container_base, sequence_container, etc).
+	/// Containers and views are GUI thread only, staging_ingress allows pushing records from any thread:
+	///  * push is lock-free - records are linked into intrusive stack via CAS.
+	///  * drain should be called from container(GUI) thread: it takes all staged records at once,
+	///    collapses records with duplicate keys(last pushed wins) and passes them into container with one upsert(or append) call.
+	///
+	/// Duplicates are collapsed with container hash_function/key_eq or key_comp, if container has them,
+	/// containers without keys(sequence_container) receive all records.
+	///
+	/// push returns true if queue was empty before, so producer can schedule drain only once(for example via GuiQueue),
+	/// or drain can be called periodically via poll with configured drain interval(for example from QTimer).
+	template <class Container>
+	class staging_ingress
+	{
+	public:
+		typedef Container                            container_type;
+		typedef typename container_type::value_type  value_type;
+		typedef std::chrono::steady_clock            clock_type;
+		typedef clock_type::duration                 duration;
+		typedef clock_type::time_point               time_point;
+
+		/// ingress statistics, drain related ones are updated by drain
+		struct ingress_counters
+		{
+			std::size_t queue_depth = 0;      // records staged right now
+			std::size_t max_queue_depth = 0;  // maximum observed queue depth
+			std::size_t drains = 0;           // number of non empty drains
+			std::size_t drained = 0;          // records taken from queue
+			std::size_t collapsed = 0;        // duplicate records dropped before reaching container
+
+			duration last_latency = {};       // how long oldest record of last drain was waiting in queue
+			duration max_latency = {};
+			duration last_drain_time = {};    // time spent in last drain: collapsing + container update
+		};
+
+	protected:
+		struct node
+		{
+			node * next;
+			time_point pushed;
+			value_type value;
+		};
+
+	protected:
+		container_type * m_owner;
+		std::atomic<node *> m_head {nullptr};
+		std::atomic<std::size_t> m_depth {0};
+		std::atomic<std::size_t> m_max_depth {0};
+
+		// consumer side state
+		ingress_counters m_counters;
+		duration m_drain_interval = {};
+		time_point m_last_drain = {};
+		std::vector<value_type> m_batch;
+
+	protected:
+		/// pushes node into stack, returns true if stack was empty
+		bool push_node(node * item) noexcept;
+		/// removes duplicates from m_batch, keeping last one, order of records is preserved
+		void collapse_batch();
+		/// marks duplicates in dups, traversing m_batch from the end
+		template <class Hash, class Equal>
+		void mark_hashed_duplicates(std::vector<char> & dups, Hash hash, Equal eq) const;
+		template <class Compare>
+		void mark_ordered_duplicates(std::vector<char> & dups, Compare comp) const;
+
+	public:
+		/// stages record, can be called from any thread.
+		/// returns true if queue was empty before this push
+		bool push(const value_type & rec) { return push_node(new node {nullptr, clock_type::now(), rec}); }
+		bool push(value_type && rec)      { return push_node(new node {nullptr, clock_type::now(), std::move(rec)}); }
+
+		template <class... Args>
+		bool emplace(Args && ... args)    { return push_node(new node {nullptr, clock_type::now(), value_type(std::forward<Args>(args)...)}); }
+
+		/// number of staged records, can be called from any thread
+		std::size_t queue_depth() const noexcept { return m_depth.load(std::memory_order_relaxed); }
+
+		/// takes all staged records and passes them into container, should be called from container thread.
+		/// returns number of records passed into container
+		std::size_t drain();
+
+		/// calls drain if drain interval elapsed since last drain, should be called from container thread.
+		/// with zero interval(default) - it's same as drain
+		std::size_t poll();
+
+		void set_drain_interval(duration interval) noexcept { m_drain_interval = interval; }
+		duration drain_interval() const noexcept { return m_drain_interval; }
+
+		/// ingress statistics, should be called from container thread
+		ingress_counters get_counters() const noexcept;
+		void reset_counters() noexcept;
+
+		container_type * get_owner() const noexcept { return m_owner; }
+
+	public:
+		staging_ingress(container_type * owner) : m_owner(owner) { assert(owner); }
+		~staging_ingress();
+
+		staging_ingress(const staging_ingress &) = delete;
+		staging_ingress & operator =(const staging_ingress &) = delete;
+	};
+
+	template <class Container>
+	bool staging_ingress<Container>::push_node(node * item) noexcept
+	{
+		auto depth = m_depth.fetch_add(1, std::memory_order_relaxed) + 1;
+		auto max_depth = m_max_depth.load(std::memory_order_relaxed);
+		while (max_depth < depth and not m_max_depth.compare_exchange_weak(max_depth, depth, std::memory_order_relaxed))
+			continue;
+
+		// item can be drained and deleted right after successful exchange - do not touch it after
+		node * head = m_head.load(std::memory_order_relaxed);
+		do item->next = head;
+		while (not m_head.compare_exchange_weak(head, item, std::memory_order_release, std::memory_order_relaxed));
+
+		return head == nullptr;
+	}
+
+	template <class Container>
+	std::size_t staging_ingress<Container>::drain()
+	{
+		auto start = clock_type::now();
+		m_last_drain = start;
+
+		// consumer takes whole stack at once - there is no ABA problem
+		node * head = m_head.exchange(nullptr, std::memory_order_acquire);
+		if (not head) return 0;
+
+		// stack is in reverse order of pushing
+		node * prev = nullptr;
+		while (head)
+		{
+			node * next = head->next;
+			head->next = prev;
+			prev = head;
+			head = next;
+		}
+
+		head = prev;
+		auto oldest = head->pushed;
+
+		m_batch.clear();
+		while (head)
+		{
+			node * next = head->next;
+			m_batch.push_back(std::move(head->value));
+			delete head;
+			head = next;
+		}
+
+		std::size_t count = m_batch.size();
+		m_depth.fetch_sub(count, std::memory_order_relaxed);
+
+		collapse_batch();
+
+		auto first = std::make_move_iterator(m_batch.begin());
+		auto last  = std::make_move_iterator(m_batch.end());
+
+		if constexpr (detail::has_upsert<container_type>::value)
+			m_owner->upsert(first, last);
+		else
+			m_owner->append(first, last);
+
+		std::size_t passed = m_batch.size();
+		m_batch.clear();
+
+		auto latency = start - oldest;
+		++m_counters.drains;
+		m_counters.drained += count;
+		m_counters.collapsed += count - passed;
+		m_counters.last_latency = latency;
+		m_counters.max_latency = std::max(m_counters.max_latency, latency);
+		m_counters.last_drain_time = clock_type::now() - start;
+
+		return passed;
+	}
+
+	template <class Container>
+	std::size_t staging_ingress<Container>::poll()
+	{
+		if (clock_type::now() - m_last_drain < m_drain_interval)
+			return 0;
+
+		return drain();
+	}
+
+	template <class Container>
+	void staging_ingress<Container>::collapse_batch()
+	{
+		if (m_batch.size() < 2) return;
+
+		std::vector<char> dups(m_batch.size(), 0);
+		if constexpr (detail::has_hash_keys<container_type>::value)
+			mark_hashed_duplicates(dups, m_owner->hash_function(), m_owner->key_eq());
+		else if constexpr (detail::has_ordered_keys<container_type>::value)
+			mark_ordered_duplicates(dups, m_owner->key_comp());
+		else
+			return;
+
+		std::size_t out = 0;
+		for (std::size_t idx = 0; idx < m_batch.size(); ++idx)
+		{
+			if (dups[idx]) continue;
+			if (out != idx) m_batch[out] = std::move(m_batch[idx]);
+			++out;
+		}
+
+		m_batch.erase(m_batch.begin() + out, m_batch.end());
+	}
+
+	template <class Container>
+	template <class Hash, class Equal>
+	void staging_ingress<Container>::mark_hashed_duplicates(std::vector<char> & dups, Hash hash, Equal eq) const
+	{
+		auto ptr_hash = [&hash](const value_type * ptr) { return hash(*ptr); };
+		auto ptr_eq = [&eq](const value_type * p1, const value_type * p2) { return eq(*p1, *p2); };
+
+		std::unordered_set<const value_type *, decltype(ptr_hash), decltype(ptr_eq)> seen(m_batch.size(), ptr_hash, ptr_eq);
+		for (std::size_t idx = m_batch.size(); idx--;)
+			dups[idx] = not seen.insert(&m_batch[idx]).second;
+	}
+
+	template <class Container>
+	template <class Compare>
+	void staging_ingress<Container>::mark_ordered_duplicates(std::vector<char> & dups, Compare comp) const
+	{
+		std::vector<const value_type *> ptrs;
+		ptrs.reserve(m_batch.size());
+		for (auto & rec : m_batch) ptrs.push_back(&rec);
+
+		// pointers preserve push order, last one of each equal group is kept
+		auto less = [&comp](const value_type * p1, const value_type * p2) { return comp(*p1, *p2); };
+		std::stable_sort(ptrs.begin(), ptrs.end(), less);
+
+		const value_type * base = m_batch.data();
+		for (std::size_t idx = 0; idx + 1 < ptrs.size(); ++idx)
+			dups[ptrs[idx] - base] = not less(ptrs[idx], ptrs[idx + 1]);
+	}
+
+	template <class Container>
+	auto staging_ingress<Container>::get_counters() const noexcept -> ingress_counters
+	{
+		auto counters = m_counters;
+		counters.queue_depth = m_depth.load(std::memory_order_relaxed);
+		counters.max_queue_depth = m_max_depth.load(std::memory_order_relaxed);
+		return counters;
+	}
+
+	template <class Container>
+	void staging_ingress<Container>::reset_counters() noexcept
+	{
+		m_counters = {};
+		m_max_depth.store(m_depth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	}
+
+	template <class Container>
+	staging_ingress<Container>::~staging_ingress()
+	{
+		node * head = m_head.exchange(nullptr, std::memory_order_acquire);
+		while (head)
+		{
+			node * next = head->next;
+			delete head;
+			head = next;
+		}
+	}
+}
@@ -0,0 +1,279 @@
+﻿#pragma once
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <unordered_map>
+
+#include <viewed/view_qtbase.hpp>
+#include <viewed/indirect_functor.hpp>
+
+#include <varalgo/sorting_algo.hpp>
+
+namespace viewed
+{
+	/// Bounded top-K view: holds best limit records of container according to SortPred, sorted,
+	/// see also view_qtbase description for more information.
+	/// Useful for "top 100 by volume" over big containers, where sorting whole container is wasteful.
+	///
+	/// View is filled with selection scan: nth_element over container and sort of best limit records, O(N + K log K).
+	/// On updates only erased, updated and inserted records are examined: inserted and updated records
+	/// are merged with current members, and scan is repeated only when some member leaves top K
+	/// (erased or updated to rank below worst unchanged member) and no newcomer took it's place.
+	/// Old values of updated records are not known, so update of worst member also causes scan.
+	///
+	/// @Param Container - class to which this view will connect and listen updates, see view_base for more description
+	/// @Param SortPred - sort predicate or std::variant of predicates, first records according to it are best,
+	///                   example: std::greater<Type> - biggest ones
+	template <class Container, class SortPred>
+	class top_k_view_qtbase : public view_qtbase<Container>
+	{
+		typedef view_qtbase<Container>                   base_type;
+		typedef top_k_view_qtbase<Container, SortPred>   self_type;
+
+	public:
+		using typename base_type::container_type;
+		using typename base_type::view_pointer_type;
+
+		typedef SortPred sort_pred_type;
+
+	protected:
+		using typename base_type::store_type;
+		using typename base_type::signal_range_type;
+		using typename base_type::model_type;
+		using typename base_type::int_vector;
+		using typename base_type::field_mask_vector;
+
+		using base_type::m_owner;
+		using base_type::m_store;
+		using base_type::get_model;
+		using base_type::get_view_pointer;
+		using base_type::change_indexes;
+		using base_type::emit_changed;
+
+	protected:
+		sort_pred_type m_sort_pred;
+		std::size_t m_limit;
+
+	public:
+		const sort_pred_type & sort_pred() const noexcept { return m_sort_pred; }
+		/// maximum number of records in view
+		std::size_t limit() const noexcept { return m_limit; }
+
+		/// changes maximum number of records, shrinking just drops tail, growing rescans container.
+		/// emits qt row signals, see notify_row_changes
+		void set_limit(std::size_t limit);
+		/// changes sort predicate and rescans container, emits qt row signals or layoutChanged
+		void sort_by(sort_pred_type pred);
+
+		/// reinitializes view with selection scan, calls qt beginResetModel/endResetModel
+		virtual void reinit_view() override;
+
+	protected:
+		/// fills records with best m_limit records of container, sorted by m_sort_pred.
+		/// sorted_erased - records being erased: container notifies views before erasing them, those are skipped
+		virtual void select_top(store_type & records, const signal_range_type & sorted_erased) const;
+		/// replaces m_store with records, emits qt row signals or layoutAboutToBeChanged/layoutChanged, see notify_row_changes
+		void assign_and_notify(store_type records);
+
+	protected:
+		/// merges inserted and updated records with current members, rescans container if some member left top K.
+		/// emits qt row signals for membership changes and dataChanged for updated members
+		virtual void update_data(
+			const signal_range_type & sorted_erased,
+			const signal_range_type & sorted_updated,
+			const signal_range_type & inserted) override;
+
+		/// erases records, also notifies sort predicate caching per record data, see invalidate_predicate
+		virtual void erase_records(const signal_range_type & sorted_erased) override;
+		/// clears view, also notifies sort predicate caching per record data, see invalidate_predicate
+		virtual void clear_view() override;
+
+	public:
+		top_k_view_qtbase(container_type * owner, std::size_t limit, sort_pred_type sortPred = {})
+			: base_type(owner), m_sort_pred(std::move(sortPred)), m_limit(limit) {}
+
+		top_k_view_qtbase(const top_k_view_qtbase &) = delete;
+		top_k_view_qtbase & operator =(const top_k_view_qtbase &) = delete;
+	};
+
+	template <class Container, class SortPred>
+	void top_k_view_qtbase<Container, SortPred>::select_top(store_type & records, const signal_range_type & sorted_erased) const
+	{
+		records.clear();
+		records.reserve(m_owner->size());
+		std::transform(m_owner->begin(), m_owner->end(), std::back_inserter(records), get_view_pointer);
+
+		if (not sorted_erased.empty())
+		{
+			auto is_erased = [&sorted_erased](view_pointer_type ptr) { return std::binary_search(sorted_erased.begin(), sorted_erased.end(), ptr); };
+			records.erase(std::remove_if(records.begin(), records.end(), is_erased), records.end());
+		}
+
+		auto comp = viewed::make_indirect_fun(m_sort_pred);
+		if (records.size() > m_limit)
+		{
+			varalgo::nth_element(records.begin(), records.begin() + m_limit, records.end(), comp);
+			records.resize(m_limit);
+		}
+
+		varalgo::sort(records.begin(), records.end(), comp);
+	}
+
+	template <class Container, class SortPred>
+	void top_k_view_qtbase<Container, SortPred>::reinit_view()
+	{
+		auto * model = get_model();
+		model->beginResetModel();
+
+		viewed::invalidate_predicate(m_sort_pred);
+		signal_range_type none;
+		select_top(m_store, none);
+
+		this->invalidate_row_index();
+		model->endResetModel();
+	}
+
+	template <class Container, class SortPred>
+	void top_k_view_qtbase<Container, SortPred>::set_limit(std::size_t limit)
+	{
+		bool shrinks = limit <= m_store.size();
+		m_limit = limit;
+
+		store_type records;
+		signal_range_type none;
+		if (shrinks) records.assign(m_store.begin(), m_store.begin() + limit);
+		else         select_top(records, none);
+
+		assign_and_notify(std::move(records));
+	}
+
+	template <class Container, class SortPred>
+	void top_k_view_qtbase<Container, SortPred>::sort_by(sort_pred_type pred)
+	{
+		m_sort_pred = std::move(pred);
+
+		store_type records;
+		signal_range_type none;
+		select_top(records, none);
+		assign_and_notify(std::move(records));
+	}
+
+	template <class Container, class SortPred>
+	void top_k_view_qtbase<Container, SortPred>::assign_and_notify(store_type records)
+	{
+		if (records == m_store) return;
+
+		std::unordered_map<view_pointer_type, int> new_rows;
+		for (std::size_t row = 0; row < records.size(); ++row)
+			new_rows.emplace(records[row], static_cast<int>(row));
+
+		int_vector index_map(m_store.size());
+		store_type removed;
+		for (std::size_t row = 0; row < m_store.size(); ++row)
+		{
+			auto it = new_rows.find(m_store[row]);
+			if (it != new_rows.end()) index_map[row] = it->second;
+			else                      index_map[row] = -1, removed.push_back(m_store[row]);
+		}
+
+		m_store = std::move(records);
+		this->invalidate_row_index();
+		if (this->notify_row_changes(index_map.cbegin(), index_map.cend(), removed))
+			return;
+
+		auto * model = get_model();
+		Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+		change_indexes(index_map.cbegin(), index_map.cend(), 0);
+		Q_EMIT model->layoutChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+	}
+
+	template <class Container, class SortPred>
+	void top_k_view_qtbase<Container, SortPred>::update_data(
+		const signal_range_type & sorted_erased,
+		const signal_range_type & sorted_updated,
+		const signal_range_type & inserted)
+	{
+		viewed::invalidate_predicate(m_sort_pred, sorted_erased, sorted_updated);
+
+		// empty by definition, nothing to select
+		if (m_limit == 0) return;
+
+		auto is_erased  = [&sorted_erased](view_pointer_type ptr) { return std::binary_search(sorted_erased.begin(), sorted_erased.end(), ptr); };
+		auto is_updated = [&sorted_updated](view_pointer_type ptr) { return std::binary_search(sorted_updated.begin(), sorted_updated.end(), ptr); };
+
+		// view is full - container may have records outside of it, those are not better than any unchanged member
+		bool full = m_store.size() == m_limit;
+
+		// unchanged members stay sorted, updated members are candidates again, as inserted and updated non members
+		store_type members, candidates;
+		for (auto * ptr : m_store)
+		{
+			if (is_erased(ptr)) continue;
+			if (is_updated(ptr)) candidates.push_back(ptr);
+			else                 members.push_back(ptr);
+		}
+
+		store_type sorted_store(m_store);
+		std::sort(sorted_store.begin(), sorted_store.end());
+		for (auto * ptr : sorted_updated)
+			if (not std::binary_search(sorted_store.begin(), sorted_store.end(), ptr)) candidates.push_back(ptr);
+
+		candidates.insert(candidates.end(), inserted.begin(), inserted.end());
+
+		auto comp = viewed::make_indirect_fun(m_sort_pred);
+		varalgo::sort(candidates.begin(), candidates.end(), comp);
+
+		store_type records;
+		records.reserve(members.size() + candidates.size());
+		varalgo::merge(members.begin(), members.end(), candidates.begin(), candidates.end(), std::back_inserter(records), comp);
+
+		// outside records are not better than worst unchanged member: top K of merged records is exact
+		// if that member is still in it, otherwise some member left top K and outside records can take it's place
+		bool exact = not full;
+		if (full and not members.empty())
+		{
+			auto worst = std::find(records.begin(), records.end(), members.back());
+			exact = worst - records.begin() >= static_cast<std::ptrdiff_t>(m_limit) - 1;
+		}
+
+		if (not exact)                          select_top(records, sorted_erased);
+		else if (records.size() > m_limit)      records.resize(m_limit);
+
+		assign_and_notify(std::move(records));
+
+		if (sorted_updated.empty()) return;
+
+		int_vector rows;
+		for (std::size_t row = 0; row < m_store.size(); ++row)
+			if (is_updated(m_store[row])) rows.push_back(static_cast<int>(row));
+
+		auto fields = this->updated_fields();
+		if (fields.size() != sorted_updated.size())
+			return emit_changed(rows.cbegin(), rows.cend());
+
+		field_mask_vector rows_fields;
+		rows_fields.reserve(rows.size());
+		for (int row : rows)
+		{
+			auto pos = std::lower_bound(sorted_updated.begin(), sorted_updated.end(), m_store[row]) - sorted_updated.begin();
+			rows_fields.push_back(fields[pos]);
+		}
+
+		emit_changed(rows.cbegin(), rows.cend(), rows_fields.cbegin());
+	}
+
+	template <class Container, class SortPred>
+	void top_k_view_qtbase<Container, SortPred>::erase_records(const signal_range_type & sorted_erased)
+	{
+		signal_range_type none;
+		update_data(sorted_erased, none, none);
+	}
+
+	template <class Container, class SortPred>
+	void top_k_view_qtbase<Container, SortPred>::clear_view()
+	{
+		viewed::invalidate_predicate(m_sort_pred);
+		base_type::clear_view();
+	}
+}
@@ -1,14 +1,34 @@
 ﻿#pragma once
 #include <vector>
 #include <ext/range/range_traits.hpp>
+#include <viewed/forward_types.hpp>
 
 #include <boost/iterator/iterator_adaptor.hpp>
 #include <boost/range/algorithm.hpp>
 #include <boost/range/algorithm_ext.hpp>
 #include <boost/range/adaptor/transformed.hpp>
+#include <boost/range/iterator_range.hpp>
 
 namespace viewed
 {
+	namespace detail
+	{
+		typedef boost::iterator_range<const field_mask_type *> field_mask_range;
+
+		template <class Container>
+		auto owner_updated_fields(const Container & owner, int) -> decltype(owner.updated_fields(), field_mask_range())
+		{
+			auto fields = owner.updated_fields();
+			return field_mask_range(boost::begin(fields), boost::end(fields));
+		}
+
+		template <class Container>
+		field_mask_range owner_updated_fields(const Container & owner, long)
+		{
+			return {};
+		}
+	}
+
 	/// This class provides base for building views based on viewed containers.
 	/// 
 	/// it provides base for other views:
@@ -35,6 +55,10 @@ namespace viewed
 	///             signal is emitted in process of updating data in container(after update/insert, before erase) with 3 ranges of pointers.
 	///             1st points to removed elements, 2nd points to elements that were updated, 3nd to newly inserted.
 	///             
+	/// * optionally updated_fields member function, valid while update signal is emitted:
+	///             random access range of field_mask_type, parallel to updated range(sorted by pointer value) - changed fields of updated records.
+	///             empty if not known.
+	///             
 	/// * on_erase member function which connects given functor with signal and returns connection.
 	///             slot signature is: void (signal_range_type erased).
 	///             signal is emitted before data is erased from container, with range of pointers to elements to erase.
@@ -91,6 +115,7 @@ namespace viewed
 		typedef typename container_type::signal_range_type   signal_range_type;
 		typedef typename container_type::scoped_connection   scoped_connection;
 		typedef std::vector<view_pointer_type>               store_type;
+		typedef detail::field_mask_range                     field_mask_range_type;
 
 	public:
 		typedef typename store_type::size_type           size_type;
@@ -198,6 +223,12 @@ namespace viewed
 		/// called when container is cleared, clears m_store.
 		virtual void clear_view();
 		
+	protected:
+		/// changed fields masks of currently processed update, parallel to sorted updated range.
+		/// Empty if owner does not provide them - all fields should be considered changed.
+		/// Valid only inside update_data
+		field_mask_range_type updated_fields() const;
+
 	protected:
 		/// removes from m_store records from recs
 		/// complexity N log2 M,
@@ -243,6 +274,12 @@ namespace viewed
 		m_erase_con = m_owner->on_erase(onerase);
 	}
 
+	template <class Container>
+	auto view_base<Container>::updated_fields() const -> field_mask_range_type
+	{
+		return detail::owner_updated_fields(*m_owner, 0);
+	}
+
 	template <class Container>
 	void view_base<Container>::reinit_view()
 	{
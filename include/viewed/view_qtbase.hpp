@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <vector>
+#include <unordered_map>
 #include <ext/range/range_traits.hpp>
 #include <viewed/qt_model.hpp>
 #include <viewed/view_base.hpp>
@@ -33,19 +34,67 @@ namespace viewed
 	protected:
 		using typename base_type::store_type;
 		using typename base_type::signal_range_type;
+		using typename base_type::field_mask_range_type;
 
 		using base_type::m_store;
 		using base_type::m_owner;
 
 		typedef std::vector<int> int_vector;
+		typedef std::vector<field_mask_type> field_mask_vector;
 		typedef viewed::AbstractItemModel model_type;
 
+		typedef std::unordered_map<view_pointer_type, std::ptrdiff_t> row_index_type;
+
+	protected:
+		/// optional pointer -> row index, see enable_row_index.
+		/// holds row + m_row_index_offset, so removing leading rows does not shift other entries
+		row_index_type m_row_index;
+		std::ptrdiff_t m_row_index_offset = 0;
+		bool m_row_index_enabled = false;
+		bool m_row_index_valid = false;
+
+		/// maximum number of row operations(remove/insert runs, single row moves) emitted instead of layoutChanged,
+		/// see notify_row_changes. 0 - always use layoutChanged
+		int m_row_signal_threshold = default_row_signal_threshold;
+
+	public:
+		static constexpr int default_row_signal_threshold = 8;
+
 	public:
 		/// reinitializes view
 		/// default implementation just copies from owner
 		/// calls qt beginResetModel/endResetModel
 		virtual void reinit_view() override;
 
+		/// enables/disables pointer -> row index, disabled by default.
+		/// With index updated/erased records are located with hash lookups instead of scanning whole view.
+		/// Index is kept current only by in place updates, appends and removal of leading rows.
+		/// Any other change of rows positions(erase not from front, insert into sorted view, resort, move, layout change)
+		/// makes it stale, and next update rebuilds it from all N rows - about the cost of the scan it replaces.
+		/// So it pays off for big views, which rows mostly do not move: updates in place, appends, ring buffer evictions
+		void enable_row_index(bool enable = true);
+		bool row_index_enabled() const noexcept { return m_row_index_enabled; }
+
+		/// small changes(erased records, few inserted, some moved ones) are reported with
+		/// beginRemoveRows/beginMoveRows/beginInsertRows, which are much cheaper for qt views than layoutChanged:
+		/// attached views relayout only affected rows, selection and scroll position are kept naturally.
+		/// If changes need more than threshold such operations - layoutChanged is emitted. 0 disables fine grained signals
+		void set_row_signal_threshold(int threshold) noexcept { m_row_signal_threshold = threshold; }
+		int row_signal_threshold() const noexcept { return m_row_signal_threshold; }
+
+	protected:
+		/// marks row index stale, it's rebuilt on next use.
+		/// Derived views must call it after rows in m_store are moved(change_indexes calls it)
+		void invalidate_row_index() noexcept { m_row_index_valid = false; }
+		/// rebuilds row index from first count rows of m_store, if it's stale
+		void ensure_row_index(std::size_t count);
+		/// adds rows [first; m_store.size()) to row index, should be called after records are appended to m_store
+		void row_index_appended(std::size_t first);
+		/// removes leading count rows from row index, should be called before those are erased from m_store
+		void row_index_front_removed(std::size_t count);
+		/// returns row of record ptr or -1 if view does not have it, row index should be valid
+		int lookup_row(view_pointer_type ptr) const;
+
 	protected:
 		/// acquires pointer to qt model, normally you would inherit both QAbstractItemModel and this class.
 		/// default implementation uses dynamic_cast
@@ -53,10 +102,38 @@ namespace viewed
 		/// emits qt signal model->dataChanged about changed rows. Changred rows are defined by [first; last)
 		/// default implantation just calls get_model->dataChanged(index(row, 0), inex(row, model->columnCount)
 		virtual void emit_changed(int_vector::const_iterator first, int_vector::const_iterator last);
-		/// changes persistent indexes via get_model->changePersistentIndex.
+		/// emits qt signal model->dataChanged about changed rows [first; last), with changed fields masks starting at fields_first.
+		/// consecutive rows with same mask are grouped, columns and roles are taken from changed_columns/changed_roles
+		virtual void emit_changed(int_vector::const_iterator first, int_vector::const_iterator last, field_mask_vector::const_iterator fields_first);
+		/// inclusive [first; last] columns range affected by changed fields mask,
+		/// default implementation returns all columns
+		virtual auto changed_columns(field_mask_type fields) -> std::pair<int, int>;
+		/// roles affected by changed fields mask, default implementation returns all_roles(empty vector)
+		virtual auto changed_roles(field_mask_type fields) -> QVector<int>;
+		/// changes persistent indexes via one get_model->changePersistentIndexList call, not moved indexes are skipped.
 		/// [first; last) - range where range[oldIdx - offset] => newIdx.
 		/// if newIdx < 0 - index should be removed(changed on invalid, qt supports it)
 		virtual void change_indexes(int_vector::const_iterator first, int_vector::const_iterator last, int offset);
+		/// notifies qt about changes already done to m_store with fine grained signals:
+		/// removed runs(bottom to top), moves of rows not in longest increasing subsequence, inserted runs(top to bottom).
+		/// m_store is replayed through intermediate states, so it's consistent with model at every signal.
+		/// returns false and does nothing if changes need more than m_row_signal_threshold operations,
+		/// caller should fall back to layoutAboutToBeChanged/change_indexes/layoutChanged.
+		///
+		/// Order preserving changes: removed_rows - sorted old rows of removed records, removed - those records,
+		/// inserted_rows - sorted new rows of inserted records. Cost does not depend on view size, except memmoves
+		virtual bool notify_row_changes(const int_vector & removed_rows, const store_type & removed, const int_vector & inserted_rows);
+		/// Any changes: [first; last) - range where range[oldIdx] => newIdx, newIdx < 0 - row is removed,
+		/// removed - pointers of removed rows in old order
+		virtual bool notify_row_changes(int_vector::const_iterator first, int_vector::const_iterator last, const store_type & removed);
+		/// groups sorted rows into [first; last] runs, returns false if ops exceed m_row_signal_threshold
+		bool make_row_runs(const int_vector & rows, std::vector<std::pair<int, int>> & runs, int & ops) const;
+		/// emits removed runs, moves of marked records in moved_order(if given) and inserted runs, see notify_row_changes.
+		/// m_store should hold old state, inserted - records of inserted runs in order
+		void replay_row_changes(
+			const std::vector<std::pair<int, int>> & removed_runs,
+			const std::vector<std::pair<int, int>> & inserted_runs,
+			const store_type & inserted, const store_type * moved_order = nullptr);
 
 	protected:
 		/// sorts erased and updated ranges by pointer value, so we can use binary search on them
@@ -76,7 +153,7 @@ namespace viewed
 		/// @Param inserted range of pointers to inserted
 		/// 
 		/// default implementation removes erased, appends inserted records, and emits dataChanged for updated ones
-		/// emits qt beginInsertRows/endInsertRows
+		/// emits qt beginRemoveRows/beginInsertRows or layoutAboutToBeChanged/layoutChanged, see notify_row_changes
 		virtual void update_data(
 			const signal_range_type & sorted_erased,
 			const signal_range_type & updated,
@@ -87,7 +164,7 @@ namespace viewed
 		/// @Param sorted_erased range of pointers to erased records, sorted by pointer value
 		/// 
 		/// default implementation, erases those records from main store
-		/// calls qt layoutAboutToBeChanged/layoutChanged
+		/// calls qt beginRemoveRows/endRemoveRows or layoutAboutToBeChanged/layoutChanged, see notify_row_changes
 		virtual void erase_records(const signal_range_type & sorted_erased) override;
 
 		/// called when container is cleared, clears m_store.
@@ -141,13 +218,112 @@ namespace viewed
 		}
 	}
 
+	template <class Container>
+	void view_qtbase<Container>::emit_changed(int_vector::const_iterator first, int_vector::const_iterator last, field_mask_vector::const_iterator fields_first)
+	{
+		if (first == last) return;
+
+		auto * model = get_model();
+		for (; first != last; ++first, ++fields_first)
+		{
+			int top, bottom;
+			top = bottom = *first;
+			auto fields = *fields_first;
+
+			// sequences with step of 1 and same changed fields
+			for (++first, ++fields_first; first != last and *first - bottom == 1 and *fields_first == fields; ++first, ++fields_first, ++bottom)
+				continue;
+
+			--first, --fields_first;
+
+			auto columns = changed_columns(fields);
+			auto top_left = model->index(top, columns.first, model_type::invalid_index);
+			auto bottom_right = model->index(bottom, columns.second, model_type::invalid_index);
+			model->dataChanged(top_left, bottom_right, changed_roles(fields));
+		}
+	}
+
+	template <class Container>
+	auto view_qtbase<Container>::changed_columns(field_mask_type fields) -> std::pair<int, int>
+	{
+		auto * model = get_model();
+		return {0, model->columnCount(model_type::invalid_index) - 1};
+	}
+
+	template <class Container>
+	auto view_qtbase<Container>::changed_roles(field_mask_type fields) -> QVector<int>
+	{
+		return model_type::all_roles;
+	}
+
+	template <class Container>
+	void view_qtbase<Container>::enable_row_index(bool enable)
+	{
+		m_row_index_enabled = enable;
+		m_row_index_valid = false;
+		row_index_type().swap(m_row_index);
+	}
+
+	template <class Container>
+	void view_qtbase<Container>::ensure_row_index(std::size_t count)
+	{
+		if (m_row_index_valid) return;
+
+		m_row_index.clear();
+		m_row_index.reserve(count);
+		m_row_index_offset = 0;
+
+		for (std::size_t row = 0; row < count; ++row)
+			m_row_index.emplace(m_store[row], row);
+
+		m_row_index_valid = true;
+	}
+
+	template <class Container>
+	void view_qtbase<Container>::row_index_appended(std::size_t first)
+	{
+		if (not m_row_index_valid) return;
+
+		for (auto row = first; row < m_store.size(); ++row)
+			m_row_index.emplace(m_store[row], row + m_row_index_offset);
+	}
+
+	template <class Container>
+	void view_qtbase<Container>::row_index_front_removed(std::size_t count)
+	{
+		if (not m_row_index_valid) return;
+
+		for (std::size_t row = 0; row < count; ++row)
+			m_row_index.erase(m_store[row]);
+
+		m_row_index_offset += count;
+	}
+
+	template <class Container>
+	int view_qtbase<Container>::lookup_row(view_pointer_type ptr) const
+	{
+		assert(m_row_index_valid);
+
+		auto it = m_row_index.find(ptr);
+		if (it == m_row_index.end()) return -1;
+
+		auto row = static_cast<int>(it->second - m_row_index_offset);
+		assert(m_store[row] == ptr);
+		return row;
+	}
+
 	template <class Container>
 	void view_qtbase<Container>::change_indexes(int_vector::const_iterator first, int_vector::const_iterator last, int offset)
 	{
+		invalidate_row_index();
+
 		auto * model = get_model();
 		auto size = last - first;
 
 		auto list = model->persistentIndexList();
+		persistent_index_remap remap;
+		remap.reserve(list.size());
+
 		for (const auto & idx : list)
 		{
 			if (!idx.isValid()) continue;
@@ -158,8 +334,187 @@ namespace viewed
 			if (row < offset) continue;
 
 			assert(row < size); (void)size;
-			auto newIdx = model->index(first[row - offset], col);
-			model->changePersistentIndex(idx, newIdx);
+			int new_row = first[row - offset];
+			if (new_row == row) continue;
+
+			auto newIdx = new_row < 0 ? model_type::invalid_index : model->index(new_row, col);
+			remap.add(idx, newIdx);
+		}
+
+		remap.apply(*model);
+	}
+
+	template <class Container>
+	bool view_qtbase<Container>::make_row_runs(const int_vector & rows, std::vector<std::pair<int, int>> & runs, int & ops) const
+	{
+		for (int row : rows)
+		{
+			if (not runs.empty() and runs.back().second == row - 1)
+				runs.back().second = row;
+			else if (++ops > m_row_signal_threshold)
+				return false;
+			else
+				runs.emplace_back(row, row);
+		}
+
+		return true;
+	}
+
+	template <class Container>
+	bool view_qtbase<Container>::notify_row_changes(const int_vector & removed_rows, const store_type & removed, const int_vector & inserted_rows)
+	{
+		assert(removed_rows.size() == removed.size());
+		assert(std::is_sorted(removed_rows.begin(), removed_rows.end()));
+		assert(std::is_sorted(inserted_rows.begin(), inserted_rows.end()));
+
+		int ops = 0;
+		std::vector<std::pair<int, int>> removed_runs, inserted_runs;
+		if (not make_row_runs(removed_rows, removed_runs, ops)) return false;
+		if (not make_row_runs(inserted_rows, inserted_runs, ops)) return false;
+		if (ops == 0) return true;
+
+		// restore old state: drop inserted runs from bottom to top, put back removed runs from top to bottom
+		store_type inserted;
+		inserted.reserve(inserted_rows.size());
+		for (auto & run : inserted_runs)
+			inserted.insert(inserted.end(), m_store.begin() + run.first, m_store.begin() + run.second + 1);
+
+		for (auto it = inserted_runs.rbegin(); it != inserted_runs.rend(); ++it)
+			m_store.erase(m_store.begin() + it->first, m_store.begin() + it->second + 1);
+
+		auto removed_it = removed.begin();
+		for (auto & run : removed_runs)
+		{
+			auto count = run.second - run.first + 1;
+			m_store.insert(m_store.begin() + run.first, removed_it, removed_it + count);
+			removed_it += count;
+		}
+
+		replay_row_changes(removed_runs, inserted_runs, inserted);
+		return true;
+	}
+
+	template <class Container>
+	bool view_qtbase<Container>::notify_row_changes(int_vector::const_iterator first, int_vector::const_iterator last, const store_type & removed)
+	{
+		int old_size = static_cast<int>(last - first);
+		int new_size = static_cast<int>(m_store.size());
+		int threshold = m_row_signal_threshold;
+		int ops = 0;
+
+		// inserted rows are those not taken by surviving records
+		int_vector removed_rows, positions; // positions - new rows of surviving records in old order
+		int_vector survivors(new_size, -1); // new row -> index in positions, -1 for inserted rows
+		positions.reserve(old_size - removed.size());
+		removed_rows.reserve(removed.size());
+
+		for (int row = 0; row < old_size; ++row)
+		{
+			if (first[row] < 0) removed_rows.push_back(row);
+			else survivors[first[row]] = static_cast<int>(positions.size()), positions.push_back(first[row]);
+		}
+
+		int_vector inserted_rows;
+		for (int row = 0; row < new_size; ++row)
+			if (survivors[row] < 0) inserted_rows.push_back(row);
+
+		if (std::is_sorted(positions.begin(), positions.end()))
+			return notify_row_changes(removed_rows, removed, inserted_rows);
+
+		// records are reordered: records from longest increasing subsequence stay in place, others are moved one by one
+		std::vector<std::pair<int, int>> removed_runs, inserted_runs;
+		if (not make_row_runs(removed_rows, removed_runs, ops)) return false;
+		if (not make_row_runs(inserted_rows, inserted_runs, ops)) return false;
+
+		std::vector<char> stays(positions.size(), 0);
+		ops += static_cast<int>(positions.size() - viewed::mark_longest_increasing(positions.begin(), positions.end(), stays.begin()));
+		if (ops > threshold) return false;
+
+		store_type new_store, inserted;
+		for (int row : inserted_rows) inserted.push_back(m_store[row]);
+
+		new_store.swap(m_store);
+		m_store.resize(old_size);
+
+		auto removed_it = removed.begin();
+		for (int row = 0; row < old_size; ++row)
+			m_store[row] = first[row] >= 0 ? new_store[first[row]] : *removed_it++;
+
+		// surviving records in target order, records to move are marked.
+		// positions are distinct new rows - walking new rows gives target order without sorting
+		store_type moved_order;
+		moved_order.reserve(positions.size());
+		for (int row = 0; row < new_size; ++row)
+		{
+			int idx = survivors[row];
+			if (idx < 0) continue;
+
+			auto ptr = new_store[row];
+			moved_order.push_back(stays[idx] ? ptr : viewed::mark_pointer(ptr));
+		}
+
+		replay_row_changes(removed_runs, inserted_runs, inserted, &moved_order);
+		assert(m_store == new_store);
+		return true;
+	}
+
+	template <class Container>
+	void view_qtbase<Container>::replay_row_changes(
+		const std::vector<std::pair<int, int>> & removed_runs,
+		const std::vector<std::pair<int, int>> & inserted_runs,
+		const store_type & inserted, const store_type * moved_order)
+	{
+		auto * model = get_model();
+		invalidate_row_index();
+
+		// removed runs, from bottom to top, so rows of not yet processed runs are not shifted
+		for (auto it = removed_runs.rbegin(); it != removed_runs.rend(); ++it)
+		{
+			model->beginRemoveRows(model_type::invalid_index, it->first, it->second);
+			m_store.erase(m_store.begin() + it->first, m_store.begin() + it->second + 1);
+			model->endRemoveRows();
+		}
+
+		// m_store holds surviving records, walk them in target order(marked - should be moved)
+		// and place every moved record right after it's predecessor
+		if (moved_order)
+		{
+			// rows of surviving records, rotated rows are updated along with rotation: O(N + moved distance) in total
+			std::unordered_map<view_pointer_type, int> rows;
+			rows.reserve(m_store.size());
+			for (std::size_t row = 0; row < m_store.size(); ++row)
+				rows.emplace(m_store[row], static_cast<int>(row));
+
+			for (std::size_t k = 0; k < moved_order->size(); ++k)
+			{
+				auto ptr = (*moved_order)[k];
+				if (not viewed::marked_pointer(ptr)) continue;
+
+				int from = rows[viewed::unmark_pointer(ptr)];
+				int dest = k == 0 ? 0 : rows[viewed::unmark_pointer((*moved_order)[k - 1])] + 1;
+				if (dest == from or dest == from + 1) continue;
+
+				auto store_first = m_store.begin();
+				bool allowed = model->beginMoveRows(model_type::invalid_index, from, from, model_type::invalid_index, dest);
+				if (dest > from) std::rotate(store_first + from, store_first + from + 1, store_first + dest);
+				else             std::rotate(store_first + dest, store_first + from, store_first + from + 1);
+				if (allowed) model->endMoveRows();
+
+				for (int row = std::min(from, dest), last = std::max(from + 1, dest); row < last; ++row)
+					rows[m_store[row]] = row;
+			}
+		}
+
+		// inserted runs, from top to bottom: rows before current run are already in their final state
+		auto inserted_it = inserted.begin();
+		for (auto & run : inserted_runs)
+		{
+			auto count = run.second - run.first + 1;
+			model->beginInsertRows(model_type::invalid_index, run.first, run.second);
+			m_store.insert(m_store.begin() + run.first, inserted_it, inserted_it + count);
+			model->endInsertRows();
+
+			inserted_it += count;
 		}
 	}
 
@@ -169,6 +524,7 @@ namespace viewed
 		auto * model = get_model();
 		model->beginResetModel();
 		base_type::reinit_view();
+		invalidate_row_index();
 		model->endResetModel();
 	}
 
@@ -193,18 +549,49 @@ namespace viewed
 		erased_first = erased_last = affected_indexes.begin();
 		changed_first = changed_last = affected_indexes.end();
 
+		if (m_row_index_enabled)
+			ensure_row_index(m_store.size());
+
 		// find/emit changes
 		if (not sorted_updated.empty())
 		{
 			auto first = m_store.begin();
 			auto last  = m_store.end();
 
-			auto is_updated = [&sorted_updated](view_pointer_type ptr) { return boost::binary_search(sorted_updated, ptr); };
-			for (auto it = std::find_if(first, last, is_updated); it != last; it = std::find_if(++it, last, is_updated))
-				*--changed_first = static_cast<int>(it - first);
+			if (m_row_index_enabled)
+			{
+				for (auto ptr : sorted_updated)
+				{
+					int row = lookup_row(ptr);
+					if (row >= 0) *--changed_first = row;
+				}
+
+				std::sort(changed_first, changed_last);
+			}
+			else
+			{
+				auto is_updated = [&sorted_updated](view_pointer_type ptr) { return boost::binary_search(sorted_updated, ptr); };
+				for (auto it = std::find_if(first, last, is_updated); it != last; it = std::find_if(++it, last, is_updated))
+					*--changed_first = static_cast<int>(it - first);
 
-			std::reverse(changed_first, changed_last);
-			emit_changed(changed_first, changed_last);
+				std::reverse(changed_first, changed_last);
+			}
+
+			auto fields = this->updated_fields();
+			if (fields.size() != sorted_updated.size())
+				emit_changed(changed_first, changed_last);
+			else
+			{
+				field_mask_vector changed_fields;
+				changed_fields.reserve(changed_last - changed_first);
+				for (auto it = changed_first; it != changed_last; ++it)
+				{
+					auto pos = std::lower_bound(sorted_updated.begin(), sorted_updated.end(), m_store[*it]) - sorted_updated.begin();
+					changed_fields.push_back(fields[pos]);
+				}
+
+				emit_changed(changed_first, changed_last, changed_fields.cbegin());
+			}
 		}
 
 
@@ -219,24 +606,37 @@ namespace viewed
 				auto * model = get_model();
 				model->beginInsertRows(model_type::invalid_index, first, last);
 				boost::push_back(m_store, inserted);
+				row_index_appended(first);
 				model->endInsertRows();
 			}
 		}
 		else
 		{
-			// some erased, some inserted -> more complex layoutAboutToBeChanged/layoutAboutToBeChanged case
+			// some erased, some inserted -> removed and inserted runs or layoutAboutToBeChanged/layoutChanged, see notify_row_changes
 			auto first = m_store.begin();
 			auto last  = m_store.end();
 
-			auto is_erased = [&sorted_erased](view_pointer_type ptr) { return boost::binary_search(sorted_erased, ptr); };
-			for (auto it = std::find_if(first, last, is_erased); it != last; it = std::find_if(++it, last, is_erased))
-				*erased_last++ = static_cast<int>(it - first);
+			if (m_row_index_enabled)
+			{
+				for (auto ptr : sorted_erased)
+				{
+					int row = lookup_row(ptr);
+					if (row >= 0) *erased_last++ = row;
+				}
 
-			auto * model = get_model();
-			Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+				std::sort(erased_first, erased_last);
+			}
+			else
+			{
+				auto is_erased = [&sorted_erased](view_pointer_type ptr) { return boost::binary_search(sorted_erased, ptr); };
+				for (auto it = std::find_if(first, last, is_erased); it != last; it = std::find_if(++it, last, is_erased))
+					*erased_last++ = static_cast<int>(it - first);
+			}
 
 			auto index_map = viewed::build_relloc_map(erased_first, erased_last, m_store.size());
-			change_indexes(index_map.begin(), index_map.end(), 0);
+			int_vector removed_rows(erased_first, erased_last), inserted_rows;
+			store_type removed;
+			for (int row : removed_rows) removed.push_back(m_store[row]);
 
 			last = viewed::remove_indexes(first, last, erased_first, erased_last);
 			
@@ -244,6 +644,14 @@ namespace viewed
 			m_store.resize(old_sz + inserted.size());
 			boost::copy(inserted, m_store.begin() + old_sz);
 
+			inserted_rows.resize(inserted.size());
+			std::iota(inserted_rows.begin(), inserted_rows.end(), static_cast<int>(old_sz));
+			if (notify_row_changes(removed_rows, removed, inserted_rows))
+				return;
+
+			auto * model = get_model();
+			Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+			change_indexes(index_map.begin(), index_map.end(), 0);
 			Q_EMIT model->layoutChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
 		}
 	}
@@ -258,24 +666,64 @@ namespace viewed
 			return boost::binary_search(sorted_erased, ptr);
 		};
 
+		auto * model = get_model();
+		auto remove_rows = [this, model](int first, int last)
+		{
+			model->beginRemoveRows(model_type::invalid_index, first, last - 1);
+			if (first == 0) row_index_front_removed(last);
+			else            invalidate_row_index();
+
+			m_store.erase(m_store.begin() + first, m_store.begin() + last);
+			model->endRemoveRows();
+		};
+
+		// leading block, like oldest records evicted from ring_sequence_container - checked without full scan
+		auto count = static_cast<int>(sorted_erased.size());
+		if (sorted_erased.size() <= m_store.size() and std::all_of(m_store.begin(), m_store.begin() + count, test))
+			return remove_rows(0, count);
+
 		int_vector affected_indexes(sorted_erased.size());
 		auto erased_first = affected_indexes.begin();
 		auto erased_last = erased_first;
 		auto first = m_store.begin();
 		auto last = m_store.end();
 
-		for (auto it = std::find_if(first, last, test); it != last; it = std::find_if(++it, last, test))
-			*erased_last++ = static_cast<int>(it - first);
+		if (m_row_index_enabled)
+		{
+			ensure_row_index(m_store.size());
+			for (auto ptr : sorted_erased)
+			{
+				int row = lookup_row(ptr);
+				if (row >= 0) *erased_last++ = row;
+			}
 
-		auto * model = get_model();
-		Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+			std::sort(erased_first, erased_last);
+		}
+		else
+		{
+			for (auto it = std::find_if(first, last, test); it != last; it = std::find_if(++it, last, test))
+				*erased_last++ = static_cast<int>(it - first);
+		}
+
+		if (erased_first == erased_last) return;
+
+		// contiguous block - simple beginRemoveRows/endRemoveRows case
+		if (erased_last[-1] - *erased_first == erased_last - erased_first - 1)
+			return remove_rows(*erased_first, erased_last[-1] + 1);
 
 		auto index_map = viewed::build_relloc_map(erased_first, erased_last, m_store.size());
-		change_indexes(index_map.begin(), index_map.end(), 0);
+		int_vector removed_rows(erased_first, erased_last);
+		store_type removed;
+		for (int row : removed_rows) removed.push_back(m_store[row]);
 
 		last = viewed::remove_indexes(first, last, erased_first, erased_last);
 		m_store.resize(last - first);
-		
+
+		if (notify_row_changes(removed_rows, removed, {}))
+			return;
+
+		Q_EMIT model->layoutAboutToBeChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
+		change_indexes(index_map.begin(), index_map.end(), 0);
 		Q_EMIT model->layoutChanged(model_type::empty_model_list, model->NoLayoutChangeHint);
 	}
 
@@ -285,6 +733,7 @@ namespace viewed
 		auto * model = get_model();
 		model->beginResetModel();
 		base_type::clear_view();
+		invalidate_row_index();
 		model->endResetModel();
 	}
 }
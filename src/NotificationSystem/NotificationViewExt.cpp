@@ -56,6 +56,13 @@ namespace QtTools::NotificationSystem
 		return false;
 	}
 
+	bool NotificationFilter::operator ==(const NotificationFilter & other) const noexcept
+	{
+		return m_levels == other.m_levels
+			and m_priorities == other.m_priorities
+			and m_filter.compare(other.m_filter, Qt::CaseInsensitive) == 0;
+	}
+
 	bool NotificationFilter::always_matches() const noexcept
 	{
 		return m_filter.isEmpty()
@@ -69,6 +76,8 @@ namespace QtTools::NotificationSystem
 		assert(store);
 
 		m_owner_store = std::move(store);
+		// backspacing in search field restores previous results instead of full refilter
+		set_filter_history_depth(8);
 
 		// from view_base_type
 		connect_signals();
@@ -87,6 +96,7 @@ namespace QtTools::NotificationSystem
 
 	void NotificationModel::Refilter()
 	{
+		auto prev = m_filter_pred;
 		auto rtypes = {
 			m_filter_pred.set_expr(m_filterStr),
 			m_filter_pred.set_expr(m_filteredLevels),
@@ -101,6 +111,7 @@ namespace QtTools::NotificationSystem
 		};
 
 		auto rtype = std::max(rtypes, pred);
+		if (rtype != viewed::refilter_type::same) push_filter_history(std::move(prev));
 		refilter_and_notify(rtype);
 	}
 
@@ -0,0 +1,585 @@
+// simple throughput benchmarks for viewed containers and views,
+// results are printed to stdout, build with optimizations enabled
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <numeric>
+#include <random>
+#include <string>
+#include <memory_resource>
+
+#include <viewed/hash_container_base.hpp>
+#include <viewed/ordered_container_base.hpp>
+#include <viewed/sequence_container.hpp>
+#include <viewed/fast_signal.hpp>
+#include <viewed/sfview_qtbase.hpp>
+#include <viewed/selectable_sfview_qtbase.hpp>
+#include <viewed/top_k_view_qtbase.hpp>
+#include <viewed/parallel_sort.hpp>
+#include <viewed/parallel_filter.hpp>
+#include <viewed/sort_key_projection.hpp>
+#include <viewed/collation_key_cache.hpp>
+
+namespace
+{
+	using clock_type = std::chrono::steady_clock;
+
+	constexpr int record_count = 1000 * 1000;
+	constexpr int batch_size   = 1000;
+
+	template <class Functor>
+	static double measure(Functor && func)
+	{
+		auto start = clock_type::now();
+		func();
+		auto stop = clock_type::now();
+		return std::chrono::duration<double, std::milli>(stop - start).count();
+	}
+
+	static std::vector<int> make_records()
+	{
+		std::vector<int> records(record_count);
+		std::iota(records.begin(), records.end(), 0);
+		std::shuffle(records.begin(), records.end(), std::mt19937(42));
+		return records;
+	}
+
+	/// upserts records by batches, erases every second one by key, then clears container
+	template <class Container>
+	static void store_benchmark(const char * name, Container & cont, const std::vector<int> & records)
+	{
+		auto insert_ms = measure([&]
+		{
+			for (auto first = records.begin(); first != records.end(); first += batch_size)
+				cont.upsert(first, first + batch_size);
+		});
+
+		auto erase_ms = measure([&]
+		{
+			for (auto it = records.begin(); it != records.end(); it += 2)
+				cont.erase(*it);
+		});
+
+		auto assign_ms = measure([&] { cont.assign(records.begin(), records.end()); });
+		auto clear_ms  = measure([&] { cont.clear(); });
+
+		std::printf("%-32s insert %8.1f ms, erase %8.1f ms, assign %8.1f ms, clear %8.1f ms\n",
+		            name, insert_ms, erase_ms, assign_ms, clear_ms);
+	}
+
+	static void allocator_benchmarks()
+	{
+		using hash = std::hash<int>;
+		using equal = std::equal_to<int>;
+		using compare = std::less<>;
+
+		using default_hash_container = viewed::hash_container_base<int>;
+		using pmr_hash_container = viewed::hash_container_base<int, hash, equal, viewed::pmr_hash_container_traits<int, hash, equal>>;
+
+		using default_ordered_container = viewed::ordered_container_base<int>;
+		using pmr_ordered_container = viewed::ordered_container_base<int, compare, viewed::pmr_ordered_container_traits<int, compare>>;
+
+		auto records = make_records();
+
+		{
+			default_hash_container cont;
+			store_benchmark("hash, std::allocator", cont, records);
+		}
+
+		{
+			std::pmr::unsynchronized_pool_resource pool;
+			pmr_hash_container cont(hash(), equal(), &pool);
+			store_benchmark("hash, pool resource", cont, records);
+		}
+
+		{
+			std::pmr::monotonic_buffer_resource arena;
+			pmr_hash_container cont(hash(), equal(), &arena);
+			store_benchmark("hash, monotonic arena", cont, records);
+		}
+
+		{
+			default_ordered_container cont;
+			store_benchmark("ordered, std::allocator", cont, records);
+		}
+
+		{
+			std::pmr::unsynchronized_pool_resource pool;
+			pmr_ordered_container cont(compare(), &pool);
+			store_benchmark("ordered, pool resource", cont, records);
+		}
+
+		{
+			std::pmr::monotonic_buffer_resource arena;
+			pmr_ordered_container cont(compare(), &arena);
+			store_benchmark("ordered, monotonic arena", cont, records);
+		}
+	}
+
+	/// appends records by batches, sums them via container iteration, erases front half, then reassigns
+	template <class Container>
+	static void sequence_benchmark(const char * name, const std::vector<int> & records)
+	{
+		Container cont;
+		long long sum = 0;
+
+		auto append_ms = measure([&]
+		{
+			for (auto first = records.begin(); first != records.end(); first += batch_size)
+				cont.append(first, first + batch_size);
+		});
+
+		auto iterate_ms = measure([&] { for (int val : cont) sum += val; });
+		auto erase_ms = measure([&] { cont.erase(cont.begin(), cont.begin() + cont.size() / 2); });
+		auto assign_ms = measure([&] { cont.assign(records.begin(), records.end()); });
+
+		std::printf("%-32s append %8.1f ms, iterate %8.1f ms, erase %8.1f ms, assign %8.1f ms (%lld)\n",
+		            name, append_ms, iterate_ms, erase_ms, assign_ms, sum);
+	}
+
+	static void sequence_storage_benchmarks()
+	{
+		auto records = make_records();
+		sequence_benchmark<viewed::sequence_container<int>>("sequence, unique_ptr per record", records);
+		sequence_benchmark<viewed::sequence_container<int, viewed::chunked_sequence_container_traits<int>>>("sequence, chunked storage", records);
+	}
+
+	/// emits update signal with given number of connected slots, measures per emission cost
+	template <class SignalTraits>
+	static void signal_benchmark(const char * name, int slot_count)
+	{
+		constexpr int emit_count = 1000 * 1000;
+
+		typename SignalTraits::update_signal_type signal;
+		std::vector<typename SignalTraits::scoped_connection> connections;
+
+		long long sum = 0;
+		auto slot = [&sum](auto && erased, auto && updated, auto && inserted) { sum += inserted.size(); };
+		for (int i = 0; i < slot_count; ++i)
+			connections.emplace_back(signal.connect(slot));
+
+		const int * records[1] = {nullptr};
+		auto range = SignalTraits::make_range(records, records + 1);
+
+		auto emit_ms = measure([&] { for (int i = 0; i < emit_count; ++i) signal(range, range, range); });
+
+		std::printf("%-32s %3d slots, %8.1f ns per emit (%lld)\n",
+		            name, slot_count, emit_ms * 1000 * 1000 / emit_count, sum);
+	}
+
+	static void signal_benchmarks()
+	{
+		for (int slot_count : {1, 8, 32})
+		{
+			signal_benchmark<viewed::default_signal_traits<int>>("signals2 signal", slot_count);
+			signal_benchmark<viewed::fast_signal_traits<int>>("fast_signal", slot_count);
+		}
+	}
+
+	/// minimal list model over view, counts qt structural notifications
+	template <class View>
+	class counting_model : public QAbstractListModel, public View
+	{
+	public:
+		long long relayouts = 0, row_signals = 0;
+
+	public:
+		QVariant data(const QModelIndex & idx, int role) const override { return {}; }
+		int rowCount(const QModelIndex & parent = QModelIndex()) const override { return static_cast<int>(this->size()); }
+
+	public:
+		template <class... Args>
+		counting_model(typename View::container_type * cont, Args && ... args) : View(cont, std::forward<Args>(args)...)
+		{
+			QObject::connect(this, &QAbstractItemModel::layoutChanged, [this] { ++relayouts; });
+			QObject::connect(this, &QAbstractItemModel::rowsInserted,  [this] { ++row_signals; });
+			QObject::connect(this, &QAbstractItemModel::rowsRemoved,   [this] { ++row_signals; });
+			QObject::connect(this, &QAbstractItemModel::rowsMoved,     [this] { ++row_signals; });
+		}
+	};
+
+	/// small updates of big sorted view: few records inserted/erased per update.
+	/// Each layoutChanged makes attached qt views relayout all rows, row signals touch only affected ones
+	static void relayout_benchmark(const char * name, int threshold)
+	{
+		using container_type = viewed::hash_container_base<int>;
+		using view_type = counting_model<viewed::sfview_qtbase<container_type, std::less<int>, viewed::null_filter>>;
+
+		constexpr int view_size = 100 * 1000;
+		constexpr int update_count = 10 * 1000;
+
+		auto records = make_records();
+		container_type cont;
+		cont.assign(records.begin(), records.begin() + view_size);
+
+		view_type view {&cont};
+		view.set_row_signal_threshold(threshold);
+		view.init();
+
+		std::mt19937 gen(42);
+		auto next = records.begin() + view_size;
+
+		auto update_ms = measure([&]
+		{
+			for (int i = 0; i < update_count; ++i)
+			{
+				if (i % 2) cont.upsert(next, next + 2), next += 2;
+				else
+				{
+					auto batch = cont.begin_batch();
+					cont.erase(records[gen() % view_size]);
+					cont.erase(records[gen() % view_size]);
+				}
+			}
+		});
+
+		std::printf("%-32s %8.1f ms, %lld relayouts, %lld row signals\n",
+		            name, update_ms, view.relayouts, view.row_signals);
+	}
+
+	/// stable sort of record pointers by value, like sfview_qtbase sorting it's store
+	static void sort_benchmarks()
+	{
+		auto records = make_records();
+		std::vector<const int *> pointers;
+		for (auto & rec : records) pointers.push_back(&rec);
+
+		auto comp = [](const int * p1, const int * p2) { return *p1 % 1000 < *p2 % 1000; };
+		auto sequential = pointers, parallel = pointers;
+
+		auto sequential_ms = measure([&] { std::stable_sort(sequential.begin(), sequential.end(), comp); });
+		auto parallel_ms = measure([&] { viewed::parallel_stable_sort(parallel.begin(), parallel.end(), comp); });
+
+		std::printf("%-32s %8.1f ms\n", "std::stable_sort", sequential_ms);
+		std::printf("%-32s %8.1f ms, %zu threads, %s\n", "viewed::parallel_stable_sort", parallel_ms,
+		            viewed::default_parallel_sort_pool().concurrency(), sequential == parallel ? "same order" : "DIFFERENT ORDER");
+	}
+
+	struct mod_key
+	{
+		int key(int val) const noexcept { return val % 1000; }
+	};
+
+	struct formatted_key
+	{
+		std::string key(int val) const { return std::to_string(val); }
+	};
+
+	/// stable sort of record pointers with comparator, recomputing keys, vs sort of projected keys
+	template <class Pred>
+	static void sort_key_benchmark(const char * name, const std::vector<const int *> & pointers, Pred pred)
+	{
+		auto comp = [&pred](const int * p1, const int * p2) { return pred.key(*p1) < pred.key(*p2); };
+		auto plain = pointers, projected = pointers;
+
+		auto plain_ms = measure([&] { std::stable_sort(plain.begin(), plain.end(), comp); });
+		auto projected_ms = measure([&]
+		{
+			auto entries = viewed::project_sort_keys(pred, projected.begin(), projected.end());
+			viewed::sort_key_entries(entries);
+			viewed::apply_key_entries(entries, projected.begin());
+		});
+
+		std::printf("%-32s %8.1f ms comparator, %8.1f ms projected, %s\n", name, plain_ms, projected_ms,
+		            plain == projected ? "same order" : "DIFFERENT ORDER");
+	}
+
+	static void sort_key_benchmarks()
+	{
+		auto records = make_records();
+		std::vector<const int *> pointers;
+		for (auto & rec : records) pointers.push_back(&rec);
+
+		sort_key_benchmark("int key(radix)", pointers, mod_key {});
+		sort_key_benchmark("formatted string key", pointers, formatted_key {});
+	}
+
+	struct number_string
+	{
+		QString operator()(int val) const { return QString::number(val); }
+	};
+
+	/// sorting by QCollator::compare in comparator vs cached collation sort keys
+	static void collation_benchmarks()
+	{
+		auto records = make_records();
+		records.resize(record_count / 5);
+
+		std::vector<const int *> pointers;
+		for (auto & rec : records) pointers.push_back(&rec);
+
+		QCollator collator;
+		collator.setCaseSensitivity(Qt::CaseInsensitive);
+
+		auto compare = [&collator](const int * p1, const int * p2) { return collator.compare(QString::number(*p1), QString::number(*p2)) < 0; };
+		auto plain = pointers, cached = pointers;
+		viewed::collation_less<int, number_string> pred {collator};
+
+		auto plain_ms = measure([&] { std::stable_sort(plain.begin(), plain.end(), compare); });
+		auto cached_ms = measure([&]
+		{
+			auto entries = viewed::project_sort_keys(pred, cached.begin(), cached.end());
+			viewed::sort_key_entries(entries);
+			viewed::apply_key_entries(entries, cached.begin());
+		});
+
+		std::printf("%-32s %8.1f ms QCollator::compare, %8.1f ms cached sort keys, %s\n", "collation", plain_ms, cached_ms,
+		            plain == cached ? "same order" : "DIFFERENT ORDER");
+	}
+
+	/// substring filter over formatted record, sequential vs viewed::parallel_filter
+	static void filter_benchmarks()
+	{
+		auto records = make_records();
+		auto pred = [](int val) { return std::to_string(val).find("77") != std::string::npos; };
+
+		auto sequential = records, parallel = records;
+		auto sequential_ms = measure([&] { sequential.erase(std::remove_if(sequential.begin(), sequential.end(), [&pred](int val) { return not pred(val); }), sequential.end()); });
+		auto parallel_ms = measure([&] { parallel.erase(viewed::parallel_filter(parallel.begin(), parallel.end(), pred), parallel.end()); });
+
+		std::printf("%-32s %8.1f ms\n", "sequential filter", sequential_ms);
+		std::printf("%-32s %8.1f ms, %zu threads, %s\n", "viewed::parallel_filter", parallel_ms,
+		            viewed::default_parallel_sort_pool().concurrency(), sequential == parallel ? "same result" : "DIFFERENT RESULT");
+	}
+
+	struct substring_filter
+	{
+		std::string expr;
+
+		viewed::refilter_type set_expr(std::string new_expr)
+		{
+			auto rtype = new_expr == expr ? viewed::refilter_type::same
+			           : new_expr.find(expr) != std::string::npos ? viewed::refilter_type::incremental
+			           : viewed::refilter_type::full;
+
+			expr = std::move(new_expr);
+			return rtype;
+		}
+
+		bool operator()(int val) const { return std::to_string(val).find(expr) != std::string::npos; }
+		bool operator ==(const substring_filter & other) const noexcept { return expr == other.expr; }
+		explicit operator bool() const noexcept { return not expr.empty(); }
+	};
+
+	template <class View>
+	class sliced_model : public counting_model<View>
+	{
+	protected:
+		// slices are driven by benchmark loop, as event loop would do
+		void schedule_refilter_slice() override {}
+
+	public:
+		using counting_model<View>::counting_model;
+	};
+
+	/// search as you type: synchronous filter_by blocks for whole refilter,
+	/// filter_by_async - for one slice at most(plus publishing)
+	static void async_refilter_benchmarks()
+	{
+		using container_type = viewed::hash_container_base<int>;
+		using view_type = sliced_model<viewed::sfview_qtbase<container_type, std::less<int>, substring_filter>>;
+
+		auto records = make_records();
+		container_type cont;
+		cont.assign(records.begin(), records.end());
+
+		view_type sync_view {&cont}, async_view {&cont};
+		sync_view.init();
+		async_view.init();
+
+		int slices = 0;
+		double max_slice_ms = 0;
+		async_view.filter_by_async(std::string("77"));
+		auto async_ms = measure([&]
+		{
+			for (bool pending = true; pending; ++slices)
+			{
+				auto start = std::chrono::steady_clock::now();
+				pending = async_view.process_refilter_slice();
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+				max_slice_ms = std::max(max_slice_ms, elapsed.count());
+			}
+		});
+
+		auto sync_ms = measure([&] { sync_view.filter_by(std::string("77")); });
+
+		std::printf("%-32s %8.1f ms\n", "filter_by", sync_ms);
+		std::printf("%-32s %8.1f ms, %d slices, longest %.1f ms, %s\n", "filter_by_async", async_ms, slices, max_slice_ms,
+		            sync_view.size() == async_view.size() ? "same rows" : "DIFFERENT ROWS");
+	}
+
+	static void filter_history_benchmark(const char * name, std::size_t depth)
+	{
+		using container_type = viewed::hash_container_base<int>;
+		using view_type = counting_model<viewed::sfview_qtbase<container_type, std::less<int>, substring_filter>>;
+
+		auto records = make_records();
+		container_type cont;
+		cont.assign(records.begin(), records.end());
+
+		view_type view {&cont};
+		view.init();
+		view.set_filter_history_depth(depth);
+
+		// typing and backspacing: only backspaces broaden the filter
+		view.filter_by(std::string("7"));
+		view.filter_by(std::string("77"));
+		view.filter_by(std::string("777"));
+
+		auto ms = measure([&]
+		{
+			view.filter_by(std::string("77"));
+			view.filter_by(std::string("7"));
+		});
+
+		std::printf("%-32s %8.1f ms, %zu rows\n", name, ms, view.size());
+	}
+
+	static void filter_history_benchmarks()
+	{
+		filter_history_benchmark("backspace, no history", 0);
+		filter_history_benchmark("backspace, filter history", 8);
+	}
+
+	static void selection_benchmarks()
+	{
+		using container_type = viewed::hash_container_base<int>;
+		using view_type = counting_model<viewed::selectable_sfview_qtbase<container_type, std::less<int>, viewed::null_filter>>;
+
+		auto records = make_records();
+		container_type cont;
+		cont.assign(records.begin(), records.end());
+
+		view_type view {&cont};
+		view.init();
+
+		auto per_row_ms = measure([&]
+		{
+			for (auto it = view.begin(); it != view.end(); ++it)
+				view.select(it);
+		});
+
+		view.clear_selection();
+		auto select_all_ms = measure([&] { view.select_all(); });
+
+		std::size_t selected = 0;
+		auto lookup_ms = measure([&]
+		{
+			for (auto it = view.begin(); it != view.end(); ++it)
+				selected += view.is_selected(it);
+		});
+
+		auto invert_ms = measure([&] { view.invert_selection(); });
+
+		std::printf("%-32s %8.1f ms\n", "select per row", per_row_ms);
+		std::printf("%-32s %8.1f ms\n", "select_all", select_all_ms);
+		std::printf("%-32s %8.1f ms\n", "invert_selection", invert_ms);
+		std::printf("%-32s %8.1f ms, %zu selected\n", "is_selected of every row", lookup_ms, selected);
+	}
+
+	template <class View>
+	class partitioned_model : public counting_model<View>
+	{
+	public:
+		void partition_by_selection() { this->m_partition_by_selection = true; }
+		using counting_model<View>::counting_model;
+	};
+
+	/// partitioned by selection: selected rows are moved between sorted runs
+	static void selection_runs_benchmarks()
+	{
+		using container_type = viewed::hash_container_base<int>;
+		using view_type = partitioned_model<viewed::selectable_sfview_qtbase<container_type, std::less<int>, viewed::null_filter>>;
+
+		auto records = make_records();
+		container_type cont;
+		cont.assign(records.begin(), records.end());
+
+		view_type view {&cont};
+		view.init();
+		view.partition_by_selection();
+
+		auto range_ms = measure([&]
+		{
+			for (int step = 0; step < 10; ++step)
+				view.select_range(view.begin() + 500 * 1000, view.begin() + 501 * 1000);
+		});
+
+		auto single_ms = measure([&]
+		{
+			for (int row = 0; row < 1000; ++row)
+				view.select_and_notify(view.begin() + 300 * 1000 + row * 7, true);
+		});
+
+		std::printf("%-32s %8.1f ms, %lld relayouts\n", "select_range 10 x 1000 rows", range_ms, view.relayouts);
+		std::printf("%-32s %8.1f ms, %zu selected\n", "select_and_notify 1000 rows", single_ms, view.seleted_elements().size());
+	}
+
+	/// top 100 of big container: full sorted view vs top-K view, initialization and small updates
+	static void top_k_benchmarks()
+	{
+		using container_type = viewed::hash_container_base<int>;
+		using sorted_type = counting_model<viewed::sfview_qtbase<container_type, std::greater<int>, viewed::null_filter>>;
+		using top_k_type = counting_model<viewed::top_k_view_qtbase<container_type, std::greater<int>>>;
+
+		auto records = make_records();
+		container_type cont;
+		cont.assign(records.begin(), records.end());
+
+		auto updates = [&cont, &records]
+		{
+			// new records and erased old ones, some of them enter or leave top
+			std::mt19937 gen(5);
+			std::uniform_int_distribution<int> dist(0, record_count + 1000);
+			int next = record_count;
+
+			for (int batch = 0; batch < 100; ++batch)
+			{
+				std::vector<int> inserted;
+				for (int idx = 0; idx < 10; ++idx) inserted.push_back(next++);
+				cont.upsert(inserted.begin(), inserted.end());
+
+				for (int idx = 0; idx < 10; ++idx) cont.erase(dist(gen));
+			}
+		};
+
+		{
+			sorted_type view {&cont};
+			auto init_ms = measure([&] { view.init(); });
+			auto update_ms = measure(updates);
+			std::printf("%-32s %8.1f ms init, %8.1f ms 100 updates\n", "sfview_qtbase, whole container", init_ms, update_ms);
+		}
+
+		cont.assign(records.begin(), records.end());
+		{
+			top_k_type view {&cont, 100};
+			auto init_ms = measure([&] { view.init(); });
+			auto update_ms = measure(updates);
+			std::printf("%-32s %8.1f ms init, %8.1f ms 100 updates\n", "top_k_view_qtbase, top 100", init_ms, update_ms);
+		}
+	}
+
+	static void relayout_benchmarks()
+	{
+		relayout_benchmark("layoutChanged only", 0);
+		relayout_benchmark("row signals", viewed::view_qtbase<viewed::hash_container_base<int>>::default_row_signal_threshold);
+	}
+}
+
+int main()
+{
+	allocator_benchmarks();
+	sequence_storage_benchmarks();
+	signal_benchmarks();
+	relayout_benchmarks();
+	sort_benchmarks();
+	sort_key_benchmarks();
+	collation_benchmarks();
+	filter_benchmarks();
+	async_refilter_benchmarks();
+	filter_history_benchmarks();
+	selection_benchmarks();
+	selection_runs_benchmarks();
+	top_k_benchmarks();
+	return 0;
+}
@@ -6,12 +6,28 @@
 
 #define BOOST_TEST_MODULE "viewed tests"
 #include <boost/test/unit_test.hpp>
+#include <thread>
+#include <numeric>
+#include <random>
 
 #include <viewed/hash_container_base.hpp>
 #include <viewed/ordered_container_base.hpp>
+#include <viewed/sequence_container.hpp>
+#include <viewed/ring_sequence_container.hpp>
+#include <viewed/staging_ingress.hpp>
+#include <viewed/container_persistence.hpp>
+#include <viewed/indexed_container_traits.hpp>
+#include <viewed/fast_signal.hpp>
+#include <viewed/parallel_sort.hpp>
+#include <viewed/parallel_filter.hpp>
+#include <viewed/sort_key_projection.hpp>
+#include <viewed/collation_key_cache.hpp>
+#include <boost/multi_index/member.hpp>
 
 #include <viewed/sfview_qtbase.hpp>
 #include <viewed/selectable_sfview_qtbase.hpp>
+#include <viewed/range_view_qtbase.hpp>
+#include <viewed/top_k_view_qtbase.hpp>
 
 template <class view_type>
 class simple_qtmodel :
@@ -23,13 +39,26 @@ class simple_qtmodel :
 	using container_type = typename view_type::container_type;
 	//using base_type = viewed::view_qtbase<viewed::hash_container_base<int>>;
 
+public:
+	/// emitted model signals counters
+	int inserts = 0, removes = 0, moves = 0, layout_changes = 0, data_changes = 0, resets = 0;
+
 public:
 	QVariant QAbstractItemModel::data(const QModelIndex & idx, int role) const { return QVariant::fromValue(*m_store[idx.row()]); }
 	int rowCount(const QModelIndex & parent = QModelIndex()) const override { return static_cast<int>(this->size()); }
 
 public:
-	simple_qtmodel(container_type * cont)
-		: base_type(cont) { }
+	template <class... Args>
+	simple_qtmodel(container_type * cont, Args && ... args)
+		: base_type(cont, std::forward<Args>(args)...)
+	{
+		QObject::connect(this, &QAbstractItemModel::rowsInserted,  [this] { ++inserts; });
+		QObject::connect(this, &QAbstractItemModel::rowsRemoved,   [this] { ++removes; });
+		QObject::connect(this, &QAbstractItemModel::rowsMoved,     [this] { ++moves; });
+		QObject::connect(this, &QAbstractItemModel::layoutChanged, [this] { ++layout_changes; });
+		QObject::connect(this, &QAbstractItemModel::dataChanged,   [this] { ++data_changes; });
+		QObject::connect(this, &QAbstractItemModel::modelReset,    [this] { ++resets; });
+	}
 };
 
 struct no_filter
@@ -205,3 +234,1644 @@ BOOST_AUTO_TEST_CASE(sfview_qtbase_presistance_test)
 	BOOST_CHECK(view.index(0).data().toInt() == -101);
 	BOOST_CHECK(view.index(1).data().toInt() == 7);
 }
+
+BOOST_AUTO_TEST_CASE(batch_update_test)
+{
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = simple_qtmodel<
+		viewed::sfview_qtbase<container_type, std::less<int>, odd_filter>
+	>;
+
+	container_type cont;
+	view_type view {&cont};
+	view.init();
+
+	int notifications = 0;
+	auto counter = [&notifications](auto && ...) { ++notifications; };
+	container_type::scoped_connection con = cont.on_update(counter);
+
+	cont.assign({10, 15, 1, 25, 100});
+	BOOST_CHECK(notifications == 1);
+
+	{
+		auto batch = cont.begin_batch();
+		cont.upsert({3, 7});
+		cont.erase(15);
+		cont.erase(3);
+		cont.upsert({15, 9});
+
+		BOOST_CHECK(notifications == 1);
+		BOOST_CHECK(is_equal_sof(view, std::vector<int> {10, 15, 1, 25, 100}));
+	}
+
+	BOOST_CHECK(notifications == 2);
+	BOOST_CHECK(is_equal_sof(view, cont));
+	BOOST_CHECK(is_equal(cont, std::vector<int> {10, 15, 1, 25, 100, 7, 9}));
+}
+
+struct stamped_record
+{
+	int key;
+	int value;
+	mutable unsigned generation = 0;
+};
+
+struct stamped_record_hash
+{
+	std::size_t operator()(const stamped_record & rec) const noexcept { return std::hash<int>()(rec.key); }
+};
+
+struct stamped_record_equal
+{
+	bool operator()(const stamped_record & r1, const stamped_record & r2) const noexcept { return r1.key == r2.key; }
+};
+
+BOOST_AUTO_TEST_CASE(stamped_assign_test)
+{
+	using traits_type = viewed::stamped_container_traits<
+		viewed::hash_container_traits<stamped_record, stamped_record_hash, stamped_record_equal>,
+		&stamped_record::generation
+	>;
+
+	using container_type = viewed::hash_container_base<stamped_record, stamped_record_hash, stamped_record_equal, traits_type>;
+	container_type cont;
+
+	std::vector<int> erased_keys;
+	auto onupdate = [&erased_keys](auto && erased, auto && updated, auto && inserted)
+	{
+		for (auto * ptr : erased) erased_keys.push_back(ptr->key);
+	};
+
+	container_type::scoped_connection con = cont.on_update(onupdate);
+
+	cont.assign({{1, 10}, {2, 20}, {3, 30}});
+	cont.assign({{2, 21}, {4, 40}});
+
+	boost::sort(erased_keys);
+	BOOST_CHECK(erased_keys == std::vector<int>({1, 3}));
+	BOOST_CHECK(cont.size() == 2);
+	BOOST_CHECK(cont.find(stamped_record {2, 0})->value == 21);
+
+	// upserted records come with stamps of next assign generation, those must not be taken as assigned
+	erased_keys.clear();
+	cont.upsert({{4, 41, 3}, {5, 50, 3}});
+	cont.assign({{2, 22}});
+
+	boost::sort(erased_keys);
+	BOOST_CHECK(erased_keys == std::vector<int>({4, 5}));
+	BOOST_CHECK(cont.size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(change_suppressing_update_test)
+{
+	using traits_type = viewed::change_suppressing_traits<
+		viewed::hash_container_traits<int, std::hash<int>, std::equal_to<int>>
+	>;
+
+	using container_type = viewed::hash_container_base<int, std::hash<int>, std::equal_to<int>, traits_type>;
+	container_type cont;
+
+	std::size_t updated_count = 0;
+	auto onupdate = [&updated_count](auto && erased, auto && updated, auto && inserted) { updated_count += updated.size(); };
+	container_type::scoped_connection con = cont.on_update(onupdate);
+
+	cont.assign({1, 2, 3});
+	cont.upsert({1, 2, 4});
+	cont.assign({1, 2, 3});
+
+	BOOST_CHECK(updated_count == 0);
+	BOOST_CHECK(cont.get_update_counters().updated == 0);
+	BOOST_CHECK(cont.get_update_counters().suppressed == 5);
+	BOOST_CHECK(is_equal(cont, std::vector<int> {1, 2, 3}));
+}
+
+struct field_record
+{
+	int key, sort_value, other_value;
+};
+
+struct field_record_hash
+{
+	std::size_t operator()(const field_record & rec) const noexcept { return std::hash<int>()(rec.key); }
+};
+
+struct field_record_equal
+{
+	bool operator()(const field_record & r1, const field_record & r2) const noexcept { return r1.key == r2.key; }
+};
+
+struct field_record_traits : viewed::hash_container_traits<field_record, field_record_hash, field_record_equal>
+{
+	static constexpr viewed::field_mask_type sort_field  = 1;
+	static constexpr viewed::field_mask_type other_field = 2;
+
+	static viewed::field_mask_type update(field_record & rec, const field_record & newrec)
+	{
+		viewed::field_mask_type fields = 0;
+		if (rec.sort_value  != newrec.sort_value)  fields |= sort_field;
+		if (rec.other_value != newrec.other_value) fields |= other_field;
+
+		rec = newrec;
+		return fields;
+	}
+};
+
+BOOST_AUTO_TEST_CASE(updated_fields_test)
+{
+	using container_type = viewed::hash_container_base<field_record, field_record_hash, field_record_equal, field_record_traits>;
+	container_type cont;
+
+	std::vector<std::pair<int, viewed::field_mask_type>> reported;
+	auto onupdate = [&cont, &reported](auto && erased, auto && updated, auto && inserted)
+	{
+		auto fields = cont.updated_fields();
+		BOOST_REQUIRE(fields.size() == updated.size());
+		for (std::size_t idx = 0; idx < fields.size(); ++idx)
+			reported.emplace_back(updated[idx]->key, fields[idx]);
+	};
+
+	container_type::scoped_connection con = cont.on_update(onupdate);
+
+	cont.assign({{1, 10, 100}, {2, 20, 200}, {3, 30, 300}});
+	BOOST_CHECK(reported.empty());
+
+	// same record updated twice in one call - masks are merged, unchanged record is suppressed
+	cont.upsert({{1, 11, 100}, {1, 11, 101}, {2, 20, 201}, {3, 30, 300}});
+	boost::sort(reported);
+
+	decltype(reported) expected = {
+		{1, field_record_traits::sort_field | field_record_traits::other_field},
+		{2, field_record_traits::other_field},
+	};
+
+	BOOST_CHECK(reported == expected);
+	BOOST_CHECK(cont.get_update_counters().suppressed == 1);
+	BOOST_CHECK(cont.updated_fields().empty());
+}
+
+BOOST_AUTO_TEST_CASE(staging_ingress_test)
+{
+	using container_type = viewed::hash_container_base<field_record, field_record_hash, field_record_equal>;
+	container_type cont;
+	viewed::staging_ingress<container_type> ingress(&cont);
+
+	constexpr int producers = 4, records = 1000;
+	std::vector<std::thread> threads;
+	for (int prod = 0; prod < producers; ++prod)
+	{
+		threads.emplace_back([&ingress, prod]
+		{
+			// every producer pushes same keys, sort_value is increasing per producer
+			for (int idx = 0; idx < records; ++idx)
+				ingress.push(field_record {idx, idx, prod});
+		});
+	}
+
+	for (auto & thr : threads) thr.join();
+	BOOST_CHECK(ingress.queue_depth() == producers * records);
+
+	BOOST_CHECK(ingress.drain() == records);
+	BOOST_CHECK(cont.size() == records);
+	BOOST_CHECK(ingress.drain() == 0);
+
+	auto counters = ingress.get_counters();
+	BOOST_CHECK(counters.queue_depth == 0);
+	BOOST_CHECK(counters.max_queue_depth == producers * records);
+	BOOST_CHECK(counters.drains == 1);
+	BOOST_CHECK(counters.drained == producers * records);
+	BOOST_CHECK(counters.collapsed == (producers - 1) * records);
+
+	// last pushed record wins
+	ingress.push(field_record {1, 10, 0});
+	ingress.push(field_record {1, 11, 0});
+	ingress.drain();
+	BOOST_CHECK(cont.find(field_record {1, 0, 0})->sort_value == 11);
+
+	// keyless containers receive all records in push order
+	viewed::sequence_container<int> seq;
+	viewed::staging_ingress<viewed::sequence_container<int>> seq_ingress(&seq);
+	BOOST_CHECK(seq_ingress.push(1));
+	BOOST_CHECK(not seq_ingress.push(1));
+	seq_ingress.push(2);
+	seq_ingress.drain();
+	BOOST_CHECK(boost::equal(seq, std::vector<int> {1, 1, 2}));
+}
+
+BOOST_AUTO_TEST_CASE(chunked_sequence_container_test)
+{
+	using traits_type = viewed::chunked_sequence_container_traits<int, 4>;
+	using container_type = viewed::sequence_container<int, traits_type>;
+	using view_type = simple_qtmodel<viewed::view_qtbase<container_type>>;
+
+	container_type cont;
+	view_type view = &cont;
+	view.init();
+
+	std::vector<int> records(10);
+	std::iota(records.begin(), records.end(), 0);
+	cont.append(records.begin(), records.end());
+
+	// elements of one chunk are placed densely
+	BOOST_CHECK(&cont[1] == &cont[0] + 1);
+	BOOST_CHECK(&cont[3] == &cont[0] + 3);
+
+	const int * ptr = &cont[9];
+	cont.erase(cont.begin(), cont.begin() + 6);
+	BOOST_CHECK(&cont[3] == ptr);
+	BOOST_CHECK(is_equal(cont, std::vector<int> {6, 7, 8, 9}));
+	BOOST_CHECK(is_equal(view, cont));
+
+	cont.assign({1, 2, 3});
+	BOOST_CHECK(is_equal(cont, std::vector<int> {1, 2, 3}));
+	BOOST_CHECK(is_equal(view, cont));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_test)
+{
+	using container_type = viewed::hash_container_base<field_record, field_record_hash, field_record_equal>;
+	container_type cont;
+
+	std::vector<field_record> records;
+	for (int idx = 0; idx < 1000; ++idx)
+		records.push_back({idx, idx, 0});
+
+	cont.assign(records.begin(), records.end());
+	auto snap1 = cont.snapshot();
+	BOOST_CHECK(snap1->size() == 1000);
+	BOOST_CHECK(cont.snapshot() == snap1);
+
+	// worker iterates first snapshot, while container changes
+	long long sum = 0;
+	std::thread worker([snap1, &sum] { for (auto & rec : *snap1) sum += rec.sort_value; });
+
+	cont.upsert({{1, 1, 1}});
+	cont.erase(field_record {2, 0, 0});
+	cont.upsert({{1000, 1000, 0}});
+	worker.join();
+
+	BOOST_CHECK(sum == 999 * 1000 / 2);
+
+	// only changed chunks are copied
+	auto snap2 = cont.snapshot();
+	BOOST_CHECK(snap2->size() == 1000);
+	BOOST_CHECK(is_equal(*snap2 | boost::adaptors::transformed([](auto & rec) { return rec.key; }),
+	                     cont  | boost::adaptors::transformed([](auto & rec) { return rec.key; })));
+
+	std::size_t shared_chunks = 0;
+	for (std::size_t idx = 0; idx < snap1->chunks().size(); ++idx)
+		shared_chunks += snap1->chunks()[idx] == snap2->chunks()[idx];
+
+	BOOST_CHECK(shared_chunks + 3 >= snap1->chunks().size());
+	BOOST_CHECK(std::count_if(snap1->begin(), snap1->end(), [](auto & rec) { return rec.other_value == 1; }) == 0);
+	BOOST_CHECK(std::count_if(snap2->begin(), snap2->end(), [](auto & rec) { return rec.other_value == 1; }) == 1);
+
+	// inside batch last snapshot is returned: neither changes made before batch, nor in place updates of batch are mixed in
+	auto with_other = [](auto & snap, int other) { return std::count_if(snap->begin(), snap->end(), [other](auto & rec) { return rec.other_value == other; }); };
+	cont.upsert({{5, 5, 7}});
+	{
+		auto batch = cont.begin_batch();
+		cont.upsert({{6, 6, 8}, {600, 600, 8}});
+		auto snap = cont.snapshot();
+		BOOST_CHECK(snap == snap2);
+		BOOST_CHECK(with_other(snap, 7) == 0 and with_other(snap, 8) == 0);
+	}
+
+	auto snap3 = cont.snapshot();
+	BOOST_CHECK(with_other(snap3, 7) == 1 and with_other(snap3, 8) == 2);
+
+	// sequence container snapshot preserves order
+	viewed::sequence_container<int> seq;
+	seq.assign({1, 2, 3, 4});
+	seq.snapshot();
+	seq.erase(seq.begin());
+	seq.append(5);
+	BOOST_CHECK(boost::equal(*seq.snapshot(), std::vector<int> {2, 3, 4, 5}));
+
+	// first snapshot taken inside batch: pending records are seen only after batch ends, exactly once
+	viewed::hash_container_base<int> batched;
+	batched.assign({1, 2, 3});
+	{
+		auto batch = batched.begin_batch();
+		batched.upsert({4});
+		batched.erase(1);
+		BOOST_CHECK(batched.snapshot()->size() == 3);
+	}
+
+	BOOST_CHECK(batched.snapshot()->size() == 3);
+	BOOST_CHECK(is_equal(*batched.snapshot(), std::vector<int> {2, 3, 4}));
+
+	viewed::sequence_container<int> batched_seq;
+	batched_seq.assign({1, 2, 3});
+	{
+		auto batch = batched_seq.begin_batch();
+		batched_seq.append(4);
+		batched_seq.erase(batched_seq.begin());
+		BOOST_CHECK(boost::equal(*batched_seq.snapshot(), std::vector<int> {1, 2, 3}));
+	}
+
+	BOOST_CHECK(boost::equal(*batched_seq.snapshot(), std::vector<int> {2, 3, 4}));
+}
+
+/// serializer of other record version, see persistence_test
+struct other_version : viewed::record_serializer<field_record> { static constexpr std::uint32_t version = 2; };
+
+BOOST_AUTO_TEST_CASE(persistence_test)
+{
+	using container_type = viewed::hash_container_base<field_record, field_record_hash, field_record_equal>;
+	auto path = (std::filesystem::temp_directory_path() / "viewed-persistence-test.bin").string();
+
+	container_type cont;
+	for (int idx = 0; idx < 1000; ++idx)
+		cont.upsert({{idx, idx * 2, idx * 3}});
+
+	viewed::save_container(cont, path);
+
+	container_type loaded;
+	BOOST_CHECK(viewed::load_container(loaded, path));
+	BOOST_CHECK(loaded.size() == cont.size());
+	BOOST_CHECK(loaded.find(field_record {10, 0, 0})->other_value == 30);
+
+	// different record version - file is ignored
+	container_type ignored;
+	BOOST_CHECK((not viewed::load_container<container_type, other_version>(ignored, path)));
+	BOOST_CHECK(ignored.empty());
+
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+	BOOST_CHECK_THROW(viewed::load_container(ignored, path), std::runtime_error);
+	BOOST_CHECK(ignored.empty());
+
+	std::filesystem::remove(path);
+	BOOST_CHECK(not viewed::load_container(ignored, path));
+}
+
+struct by_other_value {};
+
+BOOST_AUTO_TEST_CASE(secondary_index_test)
+{
+	using traits_type = viewed::indexed_container_traits<
+		viewed::hash_container_traits<field_record, field_record_hash, field_record_equal>,
+		boost::multi_index::hashed_non_unique<
+			boost::multi_index::tag<by_other_value>,
+			boost::multi_index::member<field_record, int, &field_record::other_value>
+		>
+	>;
+
+	using container_type = viewed::hash_container_base<field_record, field_record_hash, field_record_equal, traits_type>;
+	container_type cont;
+
+	auto count_by = [&cont](int other_value)
+	{
+		auto [first, last] = cont.equal_range_by<by_other_value>(other_value);
+		return std::distance(first, last);
+	};
+
+	cont.assign({{1, 0, 10}, {2, 0, 10}, {3, 0, 20}});
+	BOOST_CHECK(count_by(10) == 2);
+	BOOST_CHECK(count_by(20) == 1);
+	BOOST_CHECK(cont.find_by<by_other_value>(20)->key == 3);
+	BOOST_CHECK(cont.find_by<by_other_value>(30) == cont.end());
+
+	// update moves record to other bucket of secondary index
+	cont.upsert({{1, 0, 20}});
+	BOOST_CHECK(count_by(10) == 1);
+	BOOST_CHECK(count_by(20) == 2);
+
+	cont.erase(field_record {3, 0, 0});
+	BOOST_CHECK(count_by(20) == 1);
+
+	cont.assign({{2, 0, 30}, {4, 0, 30}});
+	BOOST_CHECK(count_by(10) == 0);
+	BOOST_CHECK(count_by(20) == 0);
+	BOOST_CHECK(count_by(30) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(range_view_test)
+{
+	using container_type = viewed::ordered_container_base<int>;
+	using view_type = simple_qtmodel<viewed::range_view_qtbase<container_type>>;
+
+	container_type cont;
+	view_type view {&cont, 10, 20};
+	view.init();
+
+	cont.assign({1, 5, 10, 12, 15, 19, 20, 25});
+	BOOST_CHECK(is_equal(view, std::vector<int> {10, 12, 15, 19}));
+
+	// appending after last row is a plain row insertion
+	QPersistentModelIndex idx = view.index(1);
+	int layouts = view.layout_changes;
+	cont.upsert({18, 30, 3});
+	BOOST_CHECK(is_equal(view, std::vector<int> {10, 12, 15, 18, 19}));
+	BOOST_CHECK(idx.row() == 1);
+
+	cont.upsert({11});
+	BOOST_CHECK(is_equal(view, std::vector<int> {10, 11, 12, 15, 18, 19}));
+	BOOST_CHECK(idx.row() == 2);
+	BOOST_CHECK(view.layout_changes == layouts + 2);
+
+	cont.erase(10);
+	cont.erase(25);
+	BOOST_CHECK(is_equal(view, std::vector<int> {11, 12, 15, 18, 19}));
+	BOOST_CHECK(idx.row() == 1);
+
+	// sliding window: rows leaving and entering range are removed/inserted
+	layouts = view.layout_changes;
+	int resets = view.resets, removes = view.removes, inserts = view.inserts;
+	view.slide(5);
+	BOOST_CHECK(view.lower() == 15 and view.upper() == 25);
+	BOOST_CHECK(is_equal(view, std::vector<int> {15, 18, 19, 20}));
+	BOOST_CHECK(not idx.isValid());
+	BOOST_CHECK(view.layout_changes == layouts);
+	BOOST_CHECK(view.resets == resets);
+	BOOST_CHECK(view.removes == removes + 1);
+	BOOST_CHECK(view.inserts == inserts + 1);
+
+	view.set_range(0, 13);
+	BOOST_CHECK(is_equal(view, std::vector<int> {1, 3, 5, 11, 12}));
+
+	view.set_range(4, 16);
+	BOOST_CHECK(is_equal(view, std::vector<int> {5, 11, 12, 15}));
+
+	view.set_range(16, 16);
+	BOOST_CHECK(view.size() == 0);
+
+	cont.upsert({16, 17});
+	BOOST_CHECK(view.size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(fast_signal_traits_test)
+{
+	using container_type = viewed::hash_container_base<int, std::hash<int>, std::equal_to<int>,
+		viewed::hash_container_traits<int, std::hash<int>, std::equal_to<int>>, viewed::fast_signal_traits<int>>;
+
+	using view_type = simple_qtmodel<viewed::sfview_qtbase<container_type, std::less<int>, odd_filter>>;
+	test_aue_sof<container_type, view_type>();
+
+	container_type::connection outlived;
+	{
+		container_type cont;
+		int first = 0, second = 0;
+		container_type::connection second_con;
+
+		// first slot disconnects itself and connects second one while signal is emitted
+		container_type::scoped_connection first_con;
+		first_con = cont.on_clear([&]
+		{
+			++first;
+			first_con.disconnect();
+			second_con = cont.on_clear([&second] { ++second; });
+		});
+
+		cont.clear();
+		BOOST_CHECK(first == 1 and second == 0);
+		BOOST_CHECK(not first_con.connected());
+		BOOST_CHECK(second_con.connected());
+
+		cont.clear();
+		BOOST_CHECK(first == 1 and second == 1);
+
+		{
+			container_type::scoped_connection scoped = cont.on_clear([&second] { second += 10; });
+			cont.clear();
+			BOOST_CHECK(second == 12);
+		}
+
+		cont.clear();
+		BOOST_CHECK(second == 13);
+
+		outlived = second_con;
+	}
+
+	BOOST_CHECK(not outlived.connected());
+	outlived.disconnect();
+}
+
+BOOST_AUTO_TEST_CASE(ring_sequence_container_test)
+{
+	using container_type = viewed::ring_sequence_container<int>;
+	using view_type = simple_qtmodel<viewed::view_qtbase<container_type>>;
+
+	container_type cont(5);
+	view_type view {&cont};
+	view.init();
+
+	int erase_signals = 0;
+	container_type::scoped_connection con = cont.on_erase([&erase_signals](auto &&) { ++erase_signals; });
+
+	cont.append({1, 2, 3, 4});
+	QPersistentModelIndex idx = view.index(3);
+
+	std::pair<int, int> removed_rows {-1, -1};
+	QObject::connect(&view, &QAbstractItemModel::rowsRemoved,
+	                 [&removed_rows](const QModelIndex &, int first, int last) { removed_rows = {first, last}; });
+
+	// oldest 2 records are evicted with one signal, view removes leading rows
+	int layouts = view.layout_changes, removes = view.removes;
+	cont.append({5, 6, 7});
+	BOOST_CHECK(is_equal(cont, std::vector<int> {3, 4, 5, 6, 7}));
+	BOOST_CHECK(is_equal(view, cont));
+	BOOST_CHECK(erase_signals == 1);
+	BOOST_CHECK(view.removes == removes + 1);
+	BOOST_CHECK((removed_rows == std::pair<int, int> {0, 1}));
+	BOOST_CHECK(view.layout_changes == layouts);
+	BOOST_CHECK(idx.row() == 1);
+
+	// more than capacity - only last records are kept
+	cont.append({10, 11, 12, 13, 14, 15, 16});
+	BOOST_CHECK(is_equal(cont, std::vector<int> {12, 13, 14, 15, 16}));
+	BOOST_CHECK(is_equal(view, cont));
+	BOOST_CHECK(not idx.isValid());
+
+	cont.erase(cont.begin() + 3);
+	BOOST_CHECK(is_equal(cont, std::vector<int> {12, 13, 14, 16}));
+	BOOST_CHECK(is_equal(view, cont));
+
+	cont.set_capacity(2);
+	BOOST_CHECK(is_equal(cont, std::vector<int> {14, 16}));
+	BOOST_CHECK(is_equal(view, cont));
+
+	{
+		auto batch = cont.begin_batch();
+		cont.push_back(20);
+		cont.push_back(21);
+		cont.push_back(22);
+	}
+
+	BOOST_CHECK(is_equal(cont, std::vector<int> {21, 22}));
+	BOOST_CHECK(is_equal(view, cont));
+
+	cont.assign({1, 2, 3});
+	BOOST_CHECK(is_equal(cont, std::vector<int> {2, 3}));
+	BOOST_CHECK(is_equal(view, cont));
+}
+
+BOOST_AUTO_TEST_CASE(row_index_test)
+{
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = simple_qtmodel<viewed::view_qtbase<container_type>>;
+	using sfview_type = simple_qtmodel<viewed::sfview_qtbase<container_type, std::less<int>, odd_filter>>;
+
+	container_type cont;
+	view_type plain {&cont}, indexed {&cont};
+	sfview_type sfplain {&cont}, sfindexed {&cont};
+
+	indexed.enable_row_index();
+	sfindexed.enable_row_index();
+
+	for (auto * view : std::initializer_list<viewed::view_qtbase<container_type> *> {&plain, &indexed, &sfplain, &sfindexed})
+		view->init();
+
+	std::mt19937 gen(7);
+	std::uniform_int_distribution<int> dist(0, 200);
+
+	for (int iteration = 0; iteration < 200; ++iteration)
+	{
+		std::vector<int> batch(5);
+		std::generate(batch.begin(), batch.end(), [&] { return dist(gen); });
+
+		switch (iteration % 4)
+		{
+			case 0:
+			case 1: cont.upsert(batch.begin(), batch.end()); break;
+			case 2: for (int val : batch) cont.erase(val); break;
+			case 3: if (iteration % 40 == 3) cont.assign(batch.begin(), batch.end()); else cont.erase(batch.front()); break;
+		}
+
+		BOOST_CHECK(boost::equal(plain, indexed));
+		BOOST_CHECK(boost::equal(sfplain, sfindexed));
+		BOOST_CHECK(is_equal_sof(sfindexed, cont));
+	}
+
+	// updates of existing records, located via index, are reported for same rows
+	std::vector<int> indexed_rows, plain_rows;
+	QObject::connect(&indexed, &QAbstractItemModel::dataChanged,
+	                 [&indexed_rows](const QModelIndex & top, const QModelIndex & bottom) { for (int row = top.row(); row <= bottom.row(); ++row) indexed_rows.push_back(row); });
+	QObject::connect(&plain, &QAbstractItemModel::dataChanged,
+	                 [&plain_rows](const QModelIndex & top, const QModelIndex & bottom) { for (int row = top.row(); row <= bottom.row(); ++row) plain_rows.push_back(row); });
+
+	std::vector<int> existing(cont.begin(), cont.end());
+	int changes = indexed.data_changes, plain_changes = plain.data_changes;
+	cont.upsert(existing.begin(), existing.begin() + 3);
+	BOOST_CHECK(indexed.data_changes > changes);
+	BOOST_CHECK(indexed.data_changes - changes == plain.data_changes - plain_changes);
+	BOOST_CHECK(indexed_rows.size() == 3);
+	BOOST_CHECK(indexed_rows == plain_rows);
+	BOOST_CHECK(boost::equal(plain, indexed));
+}
+
+/// records changePersistentIndexList calls, see persistent_index_remap_test
+struct remap_recording_model
+{
+	int calls = 0;
+	QModelIndexList from, to;
+
+	void changePersistentIndexList(const QModelIndexList & from, const QModelIndexList & to)
+	{
+		++calls;
+		this->from = from;
+		this->to = to;
+	}
+};
+
+BOOST_AUTO_TEST_CASE(persistent_index_remap_test)
+{
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = simple_qtmodel<viewed::view_qtbase<container_type>>;
+
+	container_type cont;
+	view_type view {&cont};
+	view.init();
+	cont.assign({10, 20, 30, 40, 50});
+
+	// row 0 -> 0, 1 -> 1, 2 -> 3, 3 -> 4, 4 -> removed
+	std::vector<int> new_rows = {0, 1, 3, 4, -1};
+	viewed::persistent_index_remap remap;
+	for (int row = 0; row < 5; ++row)
+		remap.add(view.index(row), new_rows[row] < 0 ? QModelIndex() : view.index(new_rows[row]));
+
+	// all changes are applied with one call, not moved rows are not passed
+	remap_recording_model model;
+	remap.apply(model);
+	BOOST_CHECK(model.calls == 1);
+	BOOST_CHECK(remap.empty());
+
+	std::vector<int> from_rows, to_rows;
+	for (auto & idx : model.from) from_rows.push_back(idx.row());
+	for (auto & idx : model.to)   to_rows.push_back(idx.isValid() ? idx.row() : -1);
+
+	BOOST_CHECK((from_rows == std::vector<int> {2, 3, 4}));
+	BOOST_CHECK((to_rows == std::vector<int> {3, 4, -1}));
+
+	// nothing to change - no call
+	remap.add(view.index(1), view.index(1));
+	remap.apply(model);
+	BOOST_CHECK(model.calls == 1);
+}
+
+BOOST_AUTO_TEST_CASE(batched_index_remap_test)
+{
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = simple_qtmodel<viewed::sfview_qtbase<container_type, std::less<int>, no_filter>>;
+
+	container_type cont;
+	view_type view {&cont};
+	view.set_row_signal_threshold(0); // always layoutChanged
+	view.init();
+
+	cont.assign({10, 20, 30, 40, 50});
+	std::vector<QPersistentModelIndex> indexes;
+	for (int row = 0; row < 5; ++row)
+		indexes.emplace_back(view.index(row));
+
+	// 25 is merged in the middle: rows 0, 1 are not moved, 2-4 are shifted, all in one layout change
+	int layouts = view.layout_changes;
+	cont.upsert({25});
+	BOOST_CHECK(view.layout_changes == layouts + 1);
+
+	std::vector<int> rows, values;
+	for (auto & idx : indexes)
+	{
+		rows.push_back(idx.row());
+		values.push_back(idx.data().toInt());
+	}
+
+	BOOST_CHECK((rows == std::vector<int> {0, 1, 3, 4, 5}));
+	BOOST_CHECK((values == std::vector<int> {10, 20, 30, 40, 50}));
+
+	{
+		auto batch = cont.begin_batch();
+		cont.erase(20);
+		cont.erase(40);
+	}
+
+	BOOST_CHECK(view.layout_changes == layouts + 2);
+	BOOST_CHECK(not indexes[1].isValid());
+	BOOST_CHECK(not indexes[3].isValid());
+	BOOST_CHECK(indexes[4].row() == 3);
+}
+
+struct ranked_less
+{
+	const std::unordered_map<int, int> * rank;
+	bool operator()(int i1, int i2) const { return rank->at(i1) < rank->at(i2); }
+};
+
+BOOST_AUTO_TEST_CASE(row_signals_test)
+{
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = simple_qtmodel<viewed::view_qtbase<container_type>>;
+	using sfview_type = simple_qtmodel<viewed::sfview_qtbase<container_type, ranked_less, no_filter>>;
+
+	std::unordered_map<int, int> rank;
+	for (int val = 0; val <= 1000; ++val) rank[val] = val;
+
+	container_type cont;
+	sfview_type view {&cont, ranked_less {&rank}};
+	view.init();
+
+	cont.assign({10, 20, 30, 40, 50});
+	std::vector<QPersistentModelIndex> indexes;
+	for (int row = 0; row < 5; ++row)
+		indexes.emplace_back(view.index(row));
+
+	auto rows = [&indexes]
+	{
+		std::vector<int> rows;
+		for (auto & idx : indexes) rows.push_back(idx.row());
+		return rows;
+	};
+
+	// assigned to empty view - one insert
+	BOOST_CHECK(view.inserts == 1 and view.layout_changes == 0);
+
+	// merged record - one insert, persistent indexes are shifted by qt itself
+	cont.upsert({25});
+	BOOST_CHECK(view.inserts == 2 and view.layout_changes == 0);
+	BOOST_CHECK((rows() == std::vector<int> {0, 1, 3, 4, 5}));
+
+	// record resorted to top - one move
+	rank[50] = 0;
+	cont.upsert({50});
+	BOOST_CHECK(view.moves == 1 and view.layout_changes == 0);
+	BOOST_CHECK((rows() == std::vector<int> {1, 2, 4, 5, 0}));
+
+	// separated erased records - two remove runs
+	{
+		auto batch = cont.begin_batch();
+		cont.erase(20);
+		cont.erase(40);
+	}
+
+	BOOST_CHECK(view.removes == 2 and view.layout_changes == 0);
+	BOOST_CHECK((rows() == std::vector<int> {1, -1, 3, -1, 0}));
+
+	// above threshold - layoutChanged
+	view.set_row_signal_threshold(1);
+	{
+		auto batch = cont.begin_batch();
+		cont.erase(10);
+		cont.erase(30);
+	}
+
+	BOOST_CHECK(view.removes == 2 and view.layout_changes == 1);
+	BOOST_CHECK((rows() == std::vector<int> {-1, -1, -1, -1, 0}));
+	BOOST_CHECK((std::vector<int>(view.begin(), view.end()) == std::vector<int> {50, 25}));
+
+	// random changes: fine grained and layout views must agree, persistent indexes must follow records
+	rank.clear();
+	for (int val = 0; val <= 1000; ++val) rank[val] = val;
+	cont.clear();
+
+	view_type plain {&cont};
+	sfview_type fine {&cont, ranked_less {&rank}}, layout {&cont, ranked_less {&rank}};
+	layout.set_row_signal_threshold(0);
+	fine.set_row_signal_threshold(100);
+
+	for (auto * model : std::initializer_list<viewed::view_qtbase<container_type> *> {&plain, &fine, &layout})
+		model->init();
+
+	std::mt19937 gen(11);
+	std::uniform_int_distribution<int> dist(0, 100), rank_dist(0, 1000);
+
+	for (int iteration = 0; iteration < 300; ++iteration)
+	{
+		std::vector<std::pair<int, QPersistentModelIndex>> fine_indexes, plain_indexes;
+		for (int row = 0; row < fine.rowCount(); ++row)   fine_indexes.emplace_back(fine.begin()[row], fine.index(row));
+		for (int row = 0; row < plain.rowCount(); ++row) plain_indexes.emplace_back(plain.begin()[row], plain.index(row));
+
+		std::vector<int> batch(iteration % 3 + 1);
+		std::generate(batch.begin(), batch.end(), [&] { return dist(gen); });
+
+		switch (iteration % 3)
+		{
+			case 0: cont.upsert(batch.begin(), batch.end()); break;
+			case 1: { auto guard = cont.begin_batch(); for (int val : batch) cont.erase(val); break; }
+			case 2: for (int val : batch) rank[val] = rank_dist(gen); cont.upsert(batch.begin(), batch.end()); break;
+		}
+
+		BOOST_CHECK(boost::equal(fine, layout));
+		BOOST_CHECK(is_equal(plain, cont));
+
+		for (auto * indexes : {&fine_indexes, &plain_indexes})
+			for (auto & [val, idx] : *indexes)
+			{
+				if (cont.find(val) == cont.end()) BOOST_CHECK(not idx.isValid());
+				else BOOST_CHECK(idx.isValid() and idx.data().toInt() == val);
+			}
+	}
+
+	BOOST_CHECK(fine.layout_changes < layout.layout_changes);
+	BOOST_CHECK(fine.moves > 0 and fine.removes > 0 and fine.inserts > 0);
+}
+
+struct mod_less
+{
+	int mod = 1000;
+	bool operator()(int i1, int i2) const noexcept { return i1 % mod < i2 % mod; }
+};
+
+/// checks that view2 has same order of records and same persistent indexes permutation as view1:
+/// before and after resort, which should reorder both views.
+/// merge inserts new records: sequential paths sort them with unstable std::sort,
+/// so after it only records of persistent indexes are compared
+template <class View1, class View2, class Resort, class Merge>
+static void check_same_view_order(View1 & view1, View2 & view2, Resort resort, Merge merge)
+{
+	auto same_order = [&]
+	{
+		return std::equal(view1.begin(), view1.end(), view2.begin(), view2.end(),
+		                  [](auto & v1, auto & v2) { return &v1 == &v2; });
+	};
+
+	BOOST_CHECK(same_order());
+
+	std::vector<QPersistentModelIndex> indexes1, indexes2;
+	for (int row = 0; row < view1.rowCount(); row += 97)
+	{
+		indexes1.emplace_back(view1.index(row));
+		indexes2.emplace_back(view2.index(row));
+	}
+
+	resort();
+	BOOST_CHECK(same_order());
+
+	for (std::size_t idx = 0; idx < indexes1.size(); ++idx)
+		BOOST_CHECK(indexes1[idx].row() == indexes2[idx].row());
+
+	merge();
+	for (std::size_t idx = 0; idx < indexes1.size(); ++idx)
+	{
+		BOOST_CHECK(indexes1[idx].isValid() == indexes2[idx].isValid());
+		if (indexes1[idx].isValid()) BOOST_CHECK(indexes1[idx].data().toInt() == indexes2[idx].data().toInt());
+	}
+}
+
+template <class View1, class View2, class Resort>
+static void check_same_view_order(View1 & view1, View2 & view2, Resort resort)
+{
+	check_same_view_order(view1, view2, resort, [] {});
+}
+
+BOOST_AUTO_TEST_CASE(parallel_sort_test)
+{
+	viewed::parallel_sort_pool pool(4);
+	std::mt19937 gen(5);
+
+	// stability: many equal keys, sequence numbers must stay ordered
+	std::vector<std::pair<int, int>> records(100 * 1000);
+	for (std::size_t idx = 0; idx < records.size(); ++idx)
+		records[idx] = {static_cast<int>(gen() % 100), static_cast<int>(idx)};
+
+	auto by_key = [](auto & r1, auto & r2) { return r1.first < r2.first; };
+	auto expected = records;
+	std::stable_sort(expected.begin(), expected.end(), by_key);
+
+	auto sorted = records;
+	viewed::parallel_stable_sort(sorted.begin(), sorted.end(), by_key, pool);
+	BOOST_CHECK(sorted == expected);
+
+	auto middle = records.begin() + 30 * 1000;
+	std::stable_sort(records.begin(), middle, by_key);
+	std::stable_sort(middle, records.end(), by_key);
+	expected = sorted = records;
+	std::inplace_merge(expected.begin(), expected.begin() + 30 * 1000, expected.end(), by_key);
+	viewed::parallel_inplace_merge(sorted.begin(), sorted.begin() + 30 * 1000, sorted.end(), by_key, pool);
+	BOOST_CHECK(sorted == expected);
+
+	// views: same order of records and same persistent indexes permutation as sequential sort
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = simple_qtmodel<viewed::sfview_qtbase<container_type, mod_less, no_filter>>;
+
+	std::vector<int> values(200 * 1000);
+	std::iota(values.begin(), values.end(), 0);
+	std::shuffle(values.begin(), values.end(), gen);
+
+	container_type cont;
+	cont.assign(values.begin(), values.begin() + 150 * 1000);
+
+	view_type sequential {&cont}, parallel {&cont};
+	parallel.set_parallel_sort_threshold(1, &pool);
+
+	sequential.init();
+	parallel.init();
+
+	check_same_view_order(sequential, parallel,
+		[&] { sequential.sort_by(mod_less {7}); parallel.sort_by(mod_less {7}); },
+		[&]
+		{
+			cont.upsert(values.begin() + 150 * 1000, values.end());
+			BOOST_CHECK(std::is_sorted(parallel.begin(), parallel.end(), mod_less {7}));
+			BOOST_CHECK(is_equal(parallel, cont));
+		});
+}
+
+struct mod_key_less
+{
+	int mod = 1000;
+	int key(int i) const noexcept { return i % mod; }
+	bool operator()(int i1, int i2) const noexcept { return key(i1) < key(i2); }
+};
+
+struct string_key_less
+{
+	std::string key(int i) const { return std::to_string(i); }
+	bool operator()(int i1, int i2) const { return key(i1) < key(i2); }
+};
+
+struct identity_key
+{
+	template <class Type> Type key(Type val) const noexcept { return val; }
+};
+
+BOOST_AUTO_TEST_CASE(sort_key_projection_test)
+{
+	static_assert(viewed::has_sort_key_v<mod_key_less, int>);
+	static_assert(not viewed::has_sort_key_v<mod_less, int>);
+
+	std::mt19937 gen(7);
+
+	// radix sort: signed and floating keys, stable for equal keys
+	std::vector<int> ints(50 * 1000);
+	std::vector<double> doubles(ints.size());
+	for (std::size_t idx = 0; idx < ints.size(); ++idx)
+	{
+		ints[idx] = static_cast<int>(gen() % 2001) - 1000;
+		doubles[idx] = ints[idx] / 7.0;
+	}
+
+	doubles[0] = -0.0;
+	doubles[1] = 0.0;
+
+	auto check_sorted = [](auto & values)
+	{
+		std::vector<const typename std::decay_t<decltype(values)>::value_type *> pointers;
+		for (auto & val : values) pointers.push_back(&val);
+
+		auto entries = viewed::project_sort_keys(identity_key {}, pointers.begin(), pointers.end());
+		viewed::sort_key_entries(entries);
+		viewed::apply_key_entries(entries, pointers.begin());
+
+		auto expected = pointers;
+		std::stable_sort(expected.begin(), expected.end(), [](auto * p1, auto * p2) { return *p1 < *p2; });
+		return pointers == expected;
+	};
+
+	BOOST_CHECK(check_sorted(ints));
+	BOOST_CHECK(check_sorted(doubles));
+
+	// views: same order of records and persistent indexes as with plain comparator
+	using container_type = viewed::hash_container_base<int>;
+	using key_view_type   = simple_qtmodel<viewed::sfview_qtbase<container_type, mod_key_less, no_filter>>;
+	using plain_view_type = simple_qtmodel<viewed::sfview_qtbase<container_type, mod_less, no_filter>>;
+	using string_view_type = simple_qtmodel<viewed::sfview_qtbase<container_type, string_key_less, no_filter>>;
+
+	std::vector<int> values(20 * 1000);
+	std::iota(values.begin(), values.end(), 0);
+	std::shuffle(values.begin(), values.end(), gen);
+
+	container_type cont;
+	cont.assign(values.begin(), values.begin() + 15 * 1000);
+
+	plain_view_type plain {&cont};
+	key_view_type projected {&cont};
+	string_view_type strings {&cont};
+
+	plain.init();
+	projected.init();
+	strings.init();
+
+	BOOST_CHECK(std::is_sorted(strings.begin(), strings.end(), string_key_less {}));
+
+	check_same_view_order(plain, projected,
+		[&] { plain.sort_by(mod_less {7}); projected.sort_by(mod_key_less {7}); },
+		[&]
+		{
+			cont.upsert(values.begin() + 15 * 1000, values.end());
+			BOOST_CHECK(std::is_sorted(projected.begin(), projected.end(), mod_key_less {7}));
+			BOOST_CHECK(std::is_sorted(strings.begin(), strings.end(), string_key_less {}));
+			BOOST_CHECK(is_equal(projected, cont));
+			BOOST_CHECK(is_equal(strings, cont));
+		});
+}
+
+struct number_string
+{
+	QString operator()(int i) const { return QString::number(i); }
+};
+
+BOOST_AUTO_TEST_CASE(collation_key_cache_test)
+{
+	using sort_pred = viewed::collation_less<int, number_string>;
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = simple_qtmodel<viewed::sfview_qtbase<container_type, sort_pred, no_filter>>;
+
+	static_assert(viewed::has_sort_key_v<sort_pred, int>);
+
+	QCollator collator;
+	collator.setCaseSensitivity(Qt::CaseInsensitive);
+	sort_pred pred {collator};
+
+	std::vector<int> values(1000);
+	std::iota(values.begin(), values.end(), 0);
+	std::shuffle(values.begin(), values.end(), std::mt19937(3));
+
+	container_type cont;
+	cont.assign(values.begin(), values.begin() + 800);
+
+	view_type view {&cont, pred};
+	view.init();
+
+	auto collated_order = [&view]
+	{
+		return std::is_sorted(view.begin(), view.end(), [](int i1, int i2) { return QString::number(i1) < QString::number(i2); });
+	};
+
+	BOOST_CHECK(collated_order());
+	BOOST_CHECK(pred.cache().size() == 800);
+
+	// new records get keys, erased ones are dropped from cache
+	cont.upsert(values.begin() + 800, values.end());
+	BOOST_CHECK(collated_order());
+	BOOST_CHECK(is_equal(view, cont));
+	BOOST_CHECK(pred.cache().size() == 1000);
+
+	cont.erase(values[0]);
+	cont.erase(values[1]);
+	BOOST_CHECK(pred.cache().size() == 998);
+	BOOST_CHECK(collated_order());
+
+	cont.clear();
+	BOOST_CHECK(pred.cache().size() == 0);
+
+	// top-K view drops keys of erased records too
+	using top_k_type = simple_qtmodel<viewed::top_k_view_qtbase<container_type, sort_pred>>;
+	sort_pred top_pred {collator};
+
+	cont.assign(values.begin(), values.end());
+	top_k_type top {&cont, 10, top_pred};
+	top.init();
+	BOOST_CHECK(top_pred.cache().size() == 1000);
+
+	// member and non member
+	cont.erase(*top.begin());
+	BOOST_CHECK(top_pred.cache().size() == 999);
+	cont.erase(999);
+	BOOST_CHECK(top_pred.cache().size() == 998);
+	BOOST_CHECK(std::is_sorted(top.begin(), top.end(), [](int i1, int i2) { return QString::number(i1) < QString::number(i2); }));
+
+	cont.clear();
+	BOOST_CHECK(top_pred.cache().size() == 0);
+}
+
+struct mod_filter
+{
+	int mod = 0;
+
+	viewed::refilter_type set_expr(int new_mod)
+	{
+		// multiples of new_mod are subset of multiples of mod
+		auto rtype = new_mod == mod ? viewed::refilter_type::same
+		           : mod and new_mod % mod == 0 ? viewed::refilter_type::incremental
+		           : viewed::refilter_type::full;
+
+		mod = new_mod;
+		return rtype;
+	}
+
+	bool operator()(int i) const noexcept { return i % mod == 0; }
+	explicit operator bool() const noexcept { return mod != 0; }
+};
+
+BOOST_AUTO_TEST_CASE(parallel_filter_test)
+{
+	viewed::parallel_sort_pool pool(4);
+
+	std::vector<int> values(100 * 1000);
+	std::iota(values.begin(), values.end(), 0);
+	std::shuffle(values.begin(), values.end(), std::mt19937(11));
+
+	auto filtered = values;
+	filtered.erase(viewed::parallel_filter(filtered.begin(), filtered.end(), mod_filter {3}, pool), filtered.end());
+
+	auto expected = values;
+	expected.erase(std::remove_if(expected.begin(), expected.end(), [](int i) { return i % 3; }), expected.end());
+	BOOST_CHECK(filtered == expected);
+
+	// views: same records, order and persistent indexes as with sequential filtering
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = simple_qtmodel<viewed::sfview_qtbase<container_type, mod_less, mod_filter>>;
+
+	container_type cont;
+	cont.assign(values.begin(), values.end());
+
+	view_type sequential {&cont, mod_less {}, mod_filter {2}}, parallel {&cont, mod_less {}, mod_filter {2}};
+	parallel.set_parallel_filter_threshold(1, &pool);
+
+	sequential.init();
+	parallel.init();
+
+	BOOST_CHECK(parallel.size() == values.size() / 2);
+
+	for (int mod : {3, 1})
+	{
+		check_same_view_order(sequential, parallel, [&]
+		{
+			BOOST_CHECK(sequential.filter_by(mod) == viewed::refilter_type::full);
+			BOOST_CHECK(parallel.filter_by(mod) == viewed::refilter_type::full);
+		});
+
+		BOOST_CHECK(parallel.size() == (values.size() + mod - 1) / mod);
+	}
+}
+
+template <class view_type>
+class async_qtmodel : public simple_qtmodel<view_type>
+{
+	using base_type = simple_qtmodel<view_type>;
+
+public:
+	int scheduled = 0;
+	std::vector<std::pair<std::size_t, std::size_t>> progress;
+
+protected:
+	// slices are driven by test via process_refilter_slice, no event loop here
+	void schedule_refilter_slice() override { ++scheduled; }
+	void refilter_progress_changed(std::size_t done, std::size_t total) override { progress.emplace_back(done, total); }
+
+public:
+	using base_type::base_type;
+};
+
+BOOST_AUTO_TEST_CASE(async_refilter_test)
+{
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = async_qtmodel<viewed::sfview_qtbase<container_type, mod_less, mod_filter>>;
+
+	std::vector<int> values(20 * 1000);
+	std::iota(values.begin(), values.end(), 0);
+	std::shuffle(values.begin(), values.end(), std::mt19937(13));
+
+	container_type cont;
+	cont.assign(values.begin(), values.begin() + 15 * 1000);
+
+	view_type view {&cont, mod_less {}, mod_filter {2}};
+	view.init();
+	view.set_refilter_slice_budget(std::chrono::steady_clock::duration::zero());
+
+	auto filtered = [&cont](int mod)
+	{
+		std::vector<int> result;
+		std::copy_if(cont.begin(), cont.end(), std::back_inserter(result), [mod](int i) { return i % mod == 0; });
+		return result;
+	};
+
+	std::vector<QPersistentModelIndex> indexes;
+	for (int row = 0; row < view.rowCount(); row += 7)
+		indexes.emplace_back(view.index(row));
+
+	// rows are not changed until refilter is completed
+	BOOST_CHECK(view.filter_by_async(3) == viewed::refilter_type::full);
+	BOOST_CHECK(view.refilter_pending());
+	BOOST_CHECK(view.scheduled == 1);
+	BOOST_CHECK(view.process_refilter_slice());
+	BOOST_CHECK(view.process_refilter_slice());
+	BOOST_CHECK(is_equal(view, filtered(2)));
+	BOOST_CHECK(view.refilter_progress().first > 0);
+	BOOST_CHECK(view.refilter_progress().second == cont.size());
+
+	// newer request cancels refilter in flight
+	BOOST_CHECK(view.filter_by_async(5) == viewed::refilter_type::full);
+	BOOST_CHECK(view.refilter_progress().first == 0);
+	BOOST_CHECK(view.process_refilter_slice());
+
+	// container changes are processed meanwhile
+	cont.upsert(values.begin() + 15 * 1000, values.end());
+	cont.erase(values[0]);
+	cont.erase(values[1]);
+
+	view.finish_refilter();
+	BOOST_CHECK(not view.refilter_pending());
+	BOOST_CHECK(view.progress.back().first == view.progress.back().second);
+	BOOST_CHECK(is_equal(view, filtered(5)));
+	BOOST_CHECK(std::is_sorted(view.begin(), view.end(), mod_less {}));
+
+	for (auto & idx : indexes)
+		BOOST_CHECK(not idx.isValid() or idx.data().toInt() % 5 == 0);
+
+	// incremental: only current rows are evaluated
+	BOOST_CHECK(view.filter_by_async(10) == viewed::refilter_type::incremental);
+	BOOST_CHECK(view.refilter_progress().second == view.size());
+	cont.upsert({values[2], 1000 * 1000 + 5});
+	view.finish_refilter();
+	BOOST_CHECK(is_equal(view, filtered(10)));
+
+	BOOST_CHECK(view.filter_by_async(20) == viewed::refilter_type::incremental);
+	view.finish_refilter();
+	BOOST_CHECK(is_equal(view, filtered(20)));
+	BOOST_CHECK(std::is_sorted(view.begin(), view.end(), mod_less {}));
+
+	// synchronous filter_by takes over pending refilter
+	view.filter_by_async(7);
+	BOOST_CHECK(view.filter_by(7) == viewed::refilter_type::same);
+	BOOST_CHECK(not view.refilter_pending());
+	BOOST_CHECK(is_equal(view, filtered(7)));
+}
+
+/// mod_filter with filter state equality and evaluations counter
+struct history_mod_filter : mod_filter
+{
+	std::shared_ptr<std::size_t> evaluations = std::make_shared<std::size_t>(0);
+
+	bool operator()(int i) const noexcept { return ++*evaluations, mod_filter::operator()(i); }
+	bool operator ==(const history_mod_filter & other) const noexcept { return mod == other.mod; }
+};
+
+BOOST_AUTO_TEST_CASE(filter_history_test)
+{
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = simple_qtmodel<viewed::sfview_qtbase<container_type, mod_less, history_mod_filter>>;
+
+	std::vector<int> values(20 * 1000);
+	std::iota(values.begin(), values.end(), 0);
+	std::shuffle(values.begin(), values.end(), std::mt19937(17));
+
+	container_type cont;
+	cont.assign(values.begin(), values.begin() + 15 * 1000);
+
+	history_mod_filter filter;
+	filter.set_expr(2);
+
+	view_type view {&cont, mod_less {}, filter};
+	view.init();
+	view.set_filter_history_depth(4);
+
+	auto filtered = [&cont](int mod)
+	{
+		std::vector<int> result;
+		std::copy_if(cont.begin(), cont.end(), std::back_inserter(result), [mod](int i) { return i % mod == 0; });
+		return result;
+	};
+
+	// narrowing and broadening back: remembered result is restored without evaluating filter
+	BOOST_CHECK(view.filter_by(4) == viewed::refilter_type::incremental);
+	BOOST_CHECK(view.filter_by(12) == viewed::refilter_type::incremental);
+
+	std::vector<QPersistentModelIndex> indexes;
+	for (int row = 0; row < view.rowCount(); row += 7)
+		indexes.emplace_back(view.index(row));
+
+	auto evaluations = *filter.evaluations;
+	BOOST_CHECK(view.filter_by(4) == viewed::refilter_type::full);
+	BOOST_CHECK(*filter.evaluations == evaluations);
+	BOOST_CHECK(is_equal(view, filtered(4)));
+	BOOST_CHECK(std::is_sorted(view.begin(), view.end(), mod_less {}));
+
+	for (auto & idx : indexes)
+		BOOST_CHECK(idx.isValid() and idx.data().toInt() % 12 == 0);
+
+	// container changes since capture: only changed records are evaluated
+	std::vector<int> inserted(values.begin() + 15 * 1000, values.begin() + 15 * 1000 + 100);
+	cont.upsert(inserted.begin(), inserted.end());
+	cont.erase(values[0]);
+	cont.erase(values[1]);
+	cont.upsert(values.begin() + 15 * 1000, values.begin() + 15 * 1000 + 10);
+
+	evaluations = *filter.evaluations;
+	BOOST_CHECK(view.filter_by(2) == viewed::refilter_type::full);
+	BOOST_CHECK(*filter.evaluations - evaluations <= inserted.size() + 2);
+	BOOST_CHECK(is_equal(view, filtered(2)));
+	BOOST_CHECK(std::is_sorted(view.begin(), view.end(), mod_less {}));
+
+	// states without history are filtered from scratch
+	evaluations = *filter.evaluations;
+	BOOST_CHECK(view.filter_by(3) == viewed::refilter_type::full);
+	BOOST_CHECK(*filter.evaluations - evaluations >= cont.size());
+	BOOST_CHECK(is_equal(view, filtered(3)));
+
+	// history is bounded by depth and dropped on reinit
+	for (int mod : {5, 7, 9, 11, 13})
+		view.filter_by(mod);
+
+	evaluations = *filter.evaluations;
+	view.filter_by(2);
+	BOOST_CHECK(*filter.evaluations - evaluations >= cont.size());
+	BOOST_CHECK(is_equal(view, filtered(2)));
+
+	view.filter_by(13);
+	evaluations = *filter.evaluations;
+	view.filter_by(11);
+	BOOST_CHECK(*filter.evaluations == evaluations);
+	BOOST_CHECK(is_equal(view, filtered(11)));
+
+	view.reinit_view();
+	evaluations = *filter.evaluations;
+	view.filter_by(13);
+	BOOST_CHECK(*filter.evaluations - evaluations >= cont.size());
+	BOOST_CHECK(is_equal(view, filtered(13)));
+}
+
+template <class view_type>
+class partitioned_qtmodel : public simple_qtmodel<view_type>
+{
+	using base_type = simple_qtmodel<view_type>;
+
+public:
+	void partition_by_selection() { this->m_partition_by_selection = true; }
+
+	using base_type::base_type;
+};
+
+BOOST_AUTO_TEST_CASE(bulk_selection_test)
+{
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = partitioned_qtmodel<viewed::selectable_sfview_qtbase<container_type, std::less<int>, odd_filter>>;
+
+	std::vector<int> values(1000);
+	std::iota(values.begin(), values.end(), 0);
+
+	container_type cont;
+	cont.assign(values.begin(), values.end());
+
+	view_type view {&cont};
+	view.init();
+
+	auto selected = [&view]
+	{
+		std::vector<int> result;
+		for (auto it = view.begin(); it != view.end(); ++it)
+			if (view.is_selected(it)) result.push_back(*it);
+		return result;
+	};
+
+	std::pair<int, int> changed_rows {-1, -1};
+	QObject::connect(&view, &QAbstractItemModel::dataChanged,
+	                 [&changed_rows](const QModelIndex & top, const QModelIndex & bottom) { changed_rows = {top.row(), bottom.row()}; });
+
+	// one notification per bulk operation, covering changed rows
+	int changes = view.data_changes;
+	view.select_all();
+	BOOST_CHECK(view.data_changes == changes + 1);
+	BOOST_CHECK((changed_rows == std::pair<int, int> {0, view.rowCount() - 1}));
+	BOOST_CHECK(selected().size() == view.size());
+
+	view.select_range(view.begin() + 10, view.begin() + 20, false);
+	BOOST_CHECK(view.data_changes == changes + 2);
+	BOOST_CHECK((changed_rows == std::pair<int, int> {10, 19}));
+	BOOST_CHECK(selected().size() == view.size() - 10);
+	BOOST_CHECK(not view.is_selected(view.begin() + 10) and view.is_selected(view.begin() + 20));
+
+	view.invert_selection();
+	BOOST_CHECK(view.data_changes == changes + 3);
+	BOOST_CHECK(is_equal(selected(), std::vector<int>(view.begin() + 10, view.begin() + 20)));
+
+	// bulk operations affect only rows of view: 0 is hidden by odd_filter
+	BOOST_CHECK(view.seleted_elements().count(&*cont.find(0)) == 0);
+	view.select(view.begin());
+
+	// erased records are dropped from selection
+	cont.erase(*(view.begin() + 10));
+	BOOST_CHECK(selected().size() == 10);
+	BOOST_CHECK(view.seleted_elements().size() == 10);
+
+	view.clear_selection();
+	BOOST_CHECK(selected().empty());
+
+	// partitioned by selection: selected rows are moved to front with one layoutChanged, order within parts is kept
+	view.partition_by_selection();
+	int layouts = view.layout_changes;
+	view.select_range(view.begin() + 100, view.begin() + 110);
+	BOOST_CHECK(view.layout_changes == layouts + 1);
+	BOOST_CHECK(std::is_partitioned(view.begin(), view.end(), [&view](auto & val) { return view.seleted_elements().count(&val); }));
+	BOOST_CHECK(std::is_sorted(view.begin(), view.begin() + 10));
+	BOOST_CHECK(std::is_sorted(view.begin() + 10, view.end()));
+
+	view.invert_selection();
+	BOOST_CHECK(view.layout_changes == layouts + 2);
+	BOOST_CHECK(selected().size() == view.size() - 10);
+	BOOST_CHECK(std::is_sorted(view.begin(), view.end() - 10));
+	BOOST_CHECK(std::is_sorted(view.end() - 10, view.end()));
+}
+
+BOOST_AUTO_TEST_CASE(selection_runs_test)
+{
+	using container_type = viewed::hash_container_base<int>;
+	using view_type = partitioned_qtmodel<viewed::selectable_sfview_qtbase<container_type, std::less<int>, no_filter>>;
+
+	std::vector<int> values(2000);
+	std::iota(values.begin(), values.end(), 0);
+	std::shuffle(values.begin(), values.end(), std::mt19937(19));
+
+	container_type cont;
+	cont.assign(values.begin(), values.begin() + 1000);
+
+	view_type view {&cont};
+	view.init();
+	view.partition_by_selection();
+
+	// view is two runs: selected and not selected, each sorted
+	auto valid_runs = [&view]
+	{
+		auto pp = std::partition_point(view.begin(), view.end(), [&view](auto & val) { return view.seleted_elements().count(&val); });
+		return std::all_of(pp, view.end(), [&view](auto & val) { return not view.seleted_elements().count(&val); })
+			and std::is_sorted(view.begin(), pp) and std::is_sorted(pp, view.end());
+	};
+
+	std::vector<std::pair<QPersistentModelIndex, int>> indexes;
+	for (int row = 0; row < view.rowCount(); row += 13)
+		indexes.emplace_back(view.index(row), view.index(row).data().toInt());
+
+	auto valid_indexes = [&indexes]
+	{
+		return std::all_of(indexes.begin(), indexes.end(), [](auto & item) { return item.first.data().toInt() == item.second; });
+	};
+
+	// bulk operations: one layout change each, changed rows are moved into sorted positions of other run
+	int layouts = view.layout_changes, moves = view.moves, changes = view.data_changes;
+	view.select_range(view.begin() + 500, view.begin() + 600);
+	view.select_range(view.begin() + 100, view.begin() + 150);
+	BOOST_CHECK(view.layout_changes == layouts + 2);
+	BOOST_CHECK(view.moves == moves and view.data_changes == changes);
+	BOOST_CHECK(view.seleted_elements().size() == 150);
+	BOOST_CHECK(valid_runs());
+	BOOST_CHECK(valid_indexes());
+
+	view.select_range(view.begin() + 50, view.begin() + 200, false);
+	BOOST_CHECK(view.seleted_elements().size() == 50);
+	BOOST_CHECK(valid_runs());
+	BOOST_CHECK(valid_indexes());
+
+	view.invert_selection();
+	BOOST_CHECK(view.seleted_elements().size() == 950);
+	BOOST_CHECK(valid_runs());
+	BOOST_CHECK(valid_indexes());
+
+	// single row moves: one rowsMoved, or dataChanged if row stays in place, no layout changes
+	layouts = view.layout_changes;
+	for (int row : {0, 10, 500, 999})
+	{
+		auto value = *(view.begin() + row);
+		int emitted = view.moves + view.data_changes;
+		auto it = view.select_and_notify(view.begin() + row, not view.is_selected(view.begin() + row));
+		BOOST_CHECK(*it == value);
+		BOOST_CHECK(view.moves + view.data_changes == emitted + 1);
+		BOOST_CHECK(view.layout_changes == layouts);
+		BOOST_CHECK(valid_runs());
+		BOOST_CHECK(valid_indexes());
+	}
+
+	// new and updated records are merged into their runs
+	cont.upsert(values.begin() + 1000, values.end());
+	cont.upsert(values.begin(), values.begin() + 100);
+	BOOST_CHECK(view.size() == values.size());
+	BOOST_CHECK(valid_runs());
+	BOOST_CHECK(valid_indexes());
+
+	// clearing merges runs
+	view.clear_selection();
+	BOOST_CHECK(std::is_sorted(view.begin(), view.end()));
+	view.select_all();
+	BOOST_CHECK(std::is_sorted(view.begin(), view.end()));
+}
+
+struct sort_value_greater
+{
+	bool operator()(const field_record & r1, const field_record & r2) const noexcept { return r1.sort_value > r2.sort_value; }
+};
+
+/// counts selection scans
+template <class view_type>
+class top_k_qtmodel : public simple_qtmodel<view_type>
+{
+	using base_type = simple_qtmodel<view_type>;
+
+public:
+	mutable int scans = 0;
+
+protected:
+	void select_top(typename view_type::store_type & records, const typename view_type::signal_range_type & sorted_erased) const override
+	{
+		++scans;
+		view_type::select_top(records, sorted_erased);
+	}
+
+public:
+	using base_type::base_type;
+};
+
+BOOST_AUTO_TEST_CASE(top_k_view_test)
+{
+	using container_type = viewed::hash_container_base<field_record, field_record_hash, field_record_equal, field_record_traits>;
+	using view_type = top_k_qtmodel<viewed::top_k_view_qtbase<container_type, sort_value_greater>>;
+
+	std::vector<int> sort_values(1000);
+	std::iota(sort_values.begin(), sort_values.end(), 0);
+	std::shuffle(sort_values.begin(), sort_values.end(), std::mt19937(23));
+
+	std::vector<field_record> records;
+	for (int key = 0; key < 1000; ++key)
+		records.push_back({key, sort_values[key] * 10, 0});
+
+	container_type cont;
+	cont.assign(records.begin(), records.end());
+
+	view_type view {&cont, 10};
+	view.init();
+
+	auto top_values = [&view]
+	{
+		std::vector<int> result;
+		for (auto & rec : view) result.push_back(rec.sort_value);
+		return result;
+	};
+
+	auto expected = [&cont, &view]
+	{
+		std::vector<int> result;
+		for (auto & rec : cont) result.push_back(rec.sort_value);
+		std::sort(result.begin(), result.end(), std::greater<>());
+		result.resize(std::min(result.size(), view.limit()));
+		return result;
+	};
+
+	BOOST_CHECK(view.scans == 1);
+	BOOST_CHECK(top_values() == expected());
+
+	auto key_of_row = [&view](int row) { return (view.begin() + row)->key; };
+	int second_key = key_of_row(1);
+	QPersistentModelIndex second = view.index(1);
+
+	// incoming records below K-th one are ignored, better ones are merged in, without scan
+	cont.upsert({{2000, 5, 0}, {2001, 15, 0}});
+	BOOST_CHECK(top_values() == expected());
+
+	cont.upsert({{2002, 100 * 1000, 0}, {2003, 9985, 0}});
+	BOOST_CHECK(view.scans == 1);
+	BOOST_CHECK(top_values() == expected());
+	BOOST_CHECK(view.size() == 10);
+	BOOST_CHECK(key_of_row(second.row()) == second_key);
+
+	// updated non member enters, updated member without rank change just emits dataChanged
+	std::pair<int, int> changed_rows {-1, -1};
+	QObject::connect(&view, &QAbstractItemModel::dataChanged,
+	                 [&changed_rows](const QModelIndex & top, const QModelIndex & bottom) { changed_rows = {top.row(), bottom.row()}; });
+
+	int changes = view.data_changes;
+	cont.upsert({{key_of_row(3), (view.begin() + 3)->sort_value, 1}});
+	BOOST_CHECK(view.data_changes == changes + 1);
+	BOOST_CHECK((changed_rows == std::pair<int, int> {3, 3}));
+
+	auto outside = std::find_if(cont.begin(), cont.end(), [&view](auto & rec) { return rec.sort_value < view.begin()[9].sort_value; });
+	cont.upsert({{outside->key, 50 * 1000, 0}});
+	BOOST_CHECK(view.scans == 1);
+	BOOST_CHECK(top_values() == expected());
+
+	// non member erased - nothing changes
+	outside = std::find_if(cont.begin(), cont.end(), [&view](auto & rec) { return rec.sort_value < view.begin()[9].sort_value; });
+	cont.erase(*outside);
+	BOOST_CHECK(view.scans == 1);
+
+	// member leaves top K - container is rescanned
+	cont.erase(view.begin()[0]);
+	BOOST_CHECK(view.scans == 2);
+	BOOST_CHECK(top_values() == expected());
+
+	cont.upsert({{key_of_row(2), -1, 0}});
+	BOOST_CHECK(view.scans == 3);
+	BOOST_CHECK(top_values() == expected());
+	BOOST_CHECK(key_of_row(second.row()) == second_key);
+
+	// member leaves, but better record replaces it
+	cont.erase(view.begin()[4]);
+	BOOST_CHECK(view.scans == 4);
+	cont.upsert({{key_of_row(5), -2, 0}, {3000, 200 * 1000, 0}});
+	BOOST_CHECK(view.scans == 4);
+	BOOST_CHECK(top_values() == expected());
+
+	// shrinking drops tail, growing rescans
+	view.set_limit(5);
+	BOOST_CHECK(view.scans == 4);
+	BOOST_CHECK(top_values() == expected());
+
+	view.set_limit(20);
+	BOOST_CHECK(view.scans == 5);
+	BOOST_CHECK(top_values() == expected());
+
+	// small container: view holds all records
+	container_type small;
+	small.assign(records.begin(), records.begin() + 5);
+	view_type small_view {&small, 10};
+	small_view.init();
+	small.erase(records[0]);
+	small.upsert({{records[1].key, -5, 0}});
+	BOOST_CHECK(small_view.scans == 1);
+	BOOST_CHECK(small_view.size() == 4);
+	BOOST_CHECK(std::is_sorted(small_view.begin(), small_view.end(), sort_value_greater {}));
+
+	// zero limit: updates are ignored without scans
+	view_type empty_view {&cont, 0};
+	empty_view.init();
+	cont.upsert({{4000, 300 * 1000, 0}});
+	cont.erase(view.begin()[0]);
+	BOOST_CHECK(empty_view.scans == 1);
+	BOOST_CHECK(empty_view.size() == 0);
+}